@@ -0,0 +1,264 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/resource.h>
+
+#include "bencode_parser.hpp"
+#include "bencoder.hpp"
+
+/*
+    Throughput, allocations per document and peak RSS of the bencode parser
+    and encoder on synthetic corpora. Usage:
+
+        bencode_bench [--min-time=<seconds>] [corpus name filter]
+
+    Numbers are only comparable between builds with the same
+    CMAKE_BUILD_TYPE, use Release when looking for regressions.
+*/
+
+namespace {
+
+std::atomic<std::size_t> allocation_count {0};
+std::atomic<std::size_t> allocated_bytes {0};
+
+}
+
+
+void *operator new(std::size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void *result = std::malloc(size == 0 ? 1 : size))
+        return result;
+    throw std::bad_alloc {};
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+
+namespace {
+
+struct corpus {
+    std::string name;
+    std::string encoded;
+};
+
+
+void append_string(std::string &out, std::string_view value) {
+    out += std::to_string(value.size());
+    out += ':';
+    out += value;
+}
+
+
+void append_integer(std::string &out, std::int64_t value) {
+    out += 'i';
+    out += std::to_string(value);
+    out += 'e';
+}
+
+
+// deterministic bytes that are mostly not valid UTF-8, like real digests
+std::string pseudo_random_bytes(std::size_t size, std::uint64_t seed) {
+    std::string result (size, '\0');
+    for (char &ch : result) {
+        seed = seed * 6364136223846793005u + 1442695040888963407u;
+        ch = static_cast<char>(seed >> 56);
+    }
+    return result;
+}
+
+
+// keys of every dictionary are written in sorted order, so encoding the parsed value gives the input back
+corpus single_file_torrent() {
+    const std::int64_t length = std::int64_t{4} << 30;
+    const std::int64_t piece_length = 1 << 18;
+
+    std::string out = "d";
+    append_string(out, "announce");
+    append_string(out, "http://tracker.example.com:6969/announce");
+    append_string(out, "info");
+    out += 'd';
+    append_string(out, "length");
+    append_integer(out, length);
+    append_string(out, "name");
+    append_string(out, "ubuntu-24.04-desktop-amd64.iso");
+    append_string(out, "piece length");
+    append_integer(out, piece_length);
+    append_string(out, "pieces");
+    append_string(out, pseudo_random_bytes(length / piece_length * 20, 1));
+    out += "ee";
+    return {"single_file", std::move(out)};
+}
+
+
+corpus multi_file_torrent(std::size_t file_count) {
+    std::string out = "d";
+    append_string(out, "announce");
+    append_string(out, "http://tracker.example.com:6969/announce");
+    append_string(out, "info");
+    out += 'd';
+    append_string(out, "files");
+    out += 'l';
+    std::int64_t total = 0;
+    for (std::size_t i = 0; i < file_count; ++i) {
+        std::int64_t length = 1000 + static_cast<std::int64_t>(i * 7919 % 100000);
+        total += length;
+        out += 'd';
+        append_string(out, "length");
+        append_integer(out, length);
+        append_string(out, "path");
+        out += 'l';
+        append_string(out, "dir" + std::to_string(i / 1000));
+        append_string(out, "file" + std::to_string(i) + ".dat");
+        out += "ee";
+    }
+    out += 'e';
+    append_string(out, "name");
+    append_string(out, "dataset");
+    append_string(out, "piece length");
+    append_integer(out, 1 << 20);
+    append_string(out, "pieces");
+    append_string(out, pseudo_random_bytes((total + (1 << 20) - 1) / (1 << 20) * 20, 2));
+    out += "ee";
+    return {"multi_file_" + std::to_string(file_count), std::move(out)};
+}
+
+
+corpus scrape_response(std::size_t torrent_count) {
+    std::string out = "d";
+    append_string(out, "files");
+    out += 'd';
+    for (std::size_t i = 0; i < torrent_count; ++i) {
+        // big-endian counter in the first bytes keeps the info hashes sorted
+        std::string info_hash = pseudo_random_bytes(20, i);
+        for (std::size_t byte = 0; byte < 8; ++byte)
+            info_hash[byte] = static_cast<char>(i >> (56 - byte*8));
+
+        append_string(out, info_hash);
+        out += 'd';
+        append_string(out, "complete");
+        append_integer(out, static_cast<std::int64_t>(i % 5000));
+        append_string(out, "downloaded");
+        append_integer(out, static_cast<std::int64_t>(i * 31 % 100000));
+        append_string(out, "incomplete");
+        append_integer(out, static_cast<std::int64_t>(i % 700));
+        out += 'e';
+    }
+    out += "ee";
+    return {"scrape_" + std::to_string(torrent_count), std::move(out)};
+}
+
+
+corpus nested_lists(std::size_t depth, std::size_t count) {
+    std::string out = "l";
+    for (std::size_t i = 0; i < count; ++i) {
+        out.append(depth, 'l');
+        append_integer(out, static_cast<std::int64_t>(i));
+        out.append(depth, 'e');
+    }
+    out += 'e';
+    return {"nested_" + std::to_string(depth) + "x" + std::to_string(count), std::move(out)};
+}
+
+
+long peak_rss_kib() {
+    rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+
+struct measurement {
+    std::size_t iterations;
+    double seconds;
+    std::size_t allocations;
+    std::size_t bytes;
+};
+
+
+measurement measure(const std::function<void()> &operation, double min_seconds) {
+    using clock = std::chrono::steady_clock;
+
+    operation(); // warm up
+
+    measurement result {0, 0, 0, 0};
+    std::size_t allocations_before = allocation_count.load();
+    std::size_t bytes_before = allocated_bytes.load();
+    clock::time_point start = clock::now();
+    do {
+        operation();
+        ++result.iterations;
+        result.seconds = std::chrono::duration<double>(clock::now() - start).count();
+    } while (result.seconds < min_seconds);
+
+    result.allocations = allocation_count.load() - allocations_before;
+    result.bytes = allocated_bytes.load() - bytes_before;
+    return result;
+}
+
+
+void report(const corpus &input, std::string_view operation, const measurement &result) {
+    double megabytes = static_cast<double>(input.encoded.size()) * result.iterations / (1 << 20);
+    std::cout << std::left << std::setw(20) << input.name << std::setw(14) << operation << std::right
+        << std::fixed << std::setprecision(1)
+        << std::setw(10) << megabytes / result.seconds << " MiB/s"
+        << std::setw(12) << result.allocations / result.iterations << " allocs/doc"
+        << std::setw(12) << result.bytes / result.iterations / 1024 << " KiB/doc"
+        << std::setw(10) << peak_rss_kib() / 1024 << " MiB peak RSS\n";
+}
+
+
+void run(const corpus &input, double min_seconds) {
+    bit_torrent::bencode_parser parser {};
+
+    report(input, "parse", measure([&] { parser.parse(input.encoded); }, min_seconds));
+    report(input, "parse_tape", measure([&] { parser.parse_tape(input.encoded); }, min_seconds));
+
+    nlohmann::json parsed = parser.parse(input.encoded);
+    if (bit_torrent::bencode_json(parsed) != input.encoded)
+        throw std::runtime_error("bencode_bench: " + input.name + " doesn't survive a round trip");
+
+    report(input, "bencode_json", measure([&] { bit_torrent::bencode_json(parsed); }, min_seconds));
+}
+
+}
+
+
+int main(int argc, char *argv[]) {
+    double min_seconds = 1.0;
+    std::string_view filter;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg.starts_with("--min-time="))
+            min_seconds = std::stod(std::string {arg.substr(11)});
+        else
+            filter = arg;
+    }
+
+    // ordered by size, peak RSS only grows
+    std::vector<std::function<corpus()>> corpora {
+        [] { return nested_lists(200, 1000); },
+        [] { return single_file_torrent(); },
+        [] { return scrape_response(50000); },
+        [] { return multi_file_torrent(100000); }
+    };
+
+    for (const std::function<corpus()> &make_corpus : corpora) {
+        corpus input = make_corpus();
+        if (input.name.find(filter) == std::string::npos)
+            continue;
+
+        std::cout << input.name << ": " << input.encoded.size() / 1024 << " KiB\n";
+        run(input, min_seconds);
+    }
+}
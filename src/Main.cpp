@@ -1,8 +1,11 @@
+#include <chrono>
 #include <iostream>
+#include <optional>
 #include <string>
 #include <vector>
 #include <cctype>
 #include <cstdlib>
+#include <filesystem>
 #include <fstream>
 #include <sstream>
 #include <arpa/inet.h>
@@ -10,44 +13,32 @@
 
 #include "lib/nlohmann/json.hpp"
 #include "bencode_parser.hpp"
+#include "bencode_query.hpp"
+#include "bencode_transcoder.hpp"
 #include "bencoder.hpp"
+#include "byte_view.hpp"
+#include "mapped_file.hpp"
+#include "piece_hash_table.hpp"
 #include "sha1.hpp"
+#include "torrent_create.hpp"
+#include "torrent_index.hpp"
+#include "torrent_schema.hpp"
+#include "torrent_verify.hpp"
 #include "tracker_request.hpp"
 
 
 using json = nlohmann::json;
 
-std::string readfile(const std::string &filename) {
-    std::ifstream fin {filename};
-    if (!fin.is_open())
-        throw std::runtime_error("readfile: unable to open file " + filename);
-
-    std::stringstream file_content;
-    file_content << fin.rdbuf();
-    fin.close();
-
-    return file_content.str();
+// hashes the info dictionary exactly as it is encoded in the torrent file
+SHA1::digest_type compute_info_hash(std::string_view info) {
+    SHA1 hasher {};
+    hasher.update(info.data(), info.size());
+    return hasher.final_raw();
 }
 
 
-json decode_bencoded_value(const std::string &encoded_value) {
-    bit_torrent::bencode_parser parser {};
-    return parser.parse(encoded_value);
-}
-
-
-std::vector<std::string> extract_piece_hashes(const std::string &hash) {
-    std::vector<std::string> result (hash.size() / (SHA1::DIGEST_SIZE*2));
-    for (std::size_t offset = 0; offset < hash.size(); offset += SHA1::DIGEST_SIZE*2) {
-        std::ostringstream hash_string;
-        for (char ch : hash.substr(offset, SHA1::DIGEST_SIZE*2)) {
-            hash_string << std::hex << std::setfill('0') << std::setw(2);
-            hash_string << (+ch & 0xFF);
-        }
-        result.push_back(hash_string.str());
-    }
-
-    return result;
+bit_torrent::piece_hash_table extract_piece_hashes(bit_torrent::byte_view pieces) {
+    return bit_torrent::piece_hash_table {pieces};
 }
 
 
@@ -64,69 +55,213 @@ int main(int argc, char* argv[]) {
     std::string command = argv[1];
 
     if (command == "decode") {
-        if (argc < 3) {
-            std::cerr << "Usage: " << argv[0] << " decode <encoded_value>" << std::endl;
+        int arg_idx = 2;
+        bit_torrent::binary_format format = bit_torrent::binary_format::BINARY_HEX;
+        if (arg_idx < argc && std::string_view {argv[arg_idx]}.starts_with("--binary=")) {
+            std::string_view name = std::string_view {argv[arg_idx]}.substr(9);
+            if (name == "base64")
+                format = bit_torrent::binary_format::BINARY_BASE64;
+            else if (name != "hex")
+                throw std::runtime_error("unknown binary format: " + std::string {name});
+            ++arg_idx;
+        }
+
+        bool from_file = arg_idx < argc && std::string_view {argv[arg_idx]} == "--file";
+        if (arg_idx + from_file >= argc) {
+            std::cerr << "Usage: " << argv[0] << " decode [--binary=hex|base64] <encoded_value> | --file <file|->" << std::endl;
             return 1;
         }
         // You can use print statements as follows for debugging, they'll be visible when running tests.
         std::cerr << "Logs from your program will appear here!" << std::endl;
 
-        // Uncomment this block to pass the first stage
-        std::string encoded_value = argv[2];
-        json decoded_value = decode_bencoded_value(encoded_value);
-        std::cout << decoded_value.dump() << std::endl;
+        // transcoded straight to the output, no JSON tree is built
+        std::cout << std::nounitbuf;
+        if (!from_file) {
+            bit_torrent::bencode_to_json(argv[arg_idx], std::cout, format);
+        } else if (std::string_view {argv[arg_idx+1]} == "-") {
+            bit_torrent::bencode_to_json(std::cin, std::cout, format);
+        } else {
+            std::ifstream input {argv[arg_idx+1], std::ios::binary};
+            if (!input)
+                throw std::runtime_error("can't open file: " + std::string {argv[arg_idx+1]});
+            bit_torrent::bencode_to_json(input, std::cout, format);
+        }
+        std::cout.flush();
     } else if (command == "info") {
         if (argc < 3) {
             std::cerr << "Usage: " << argv[0] << " info <file>" << std::endl;
             return 1;
         }
 
-        json torrent_info = decode_bencoded_value(readfile(argv[2]));
+        bit_torrent::mapped_file torrent_file {argv[2]};
+        bit_torrent::torrent_metainfo torrent = bit_torrent::bencode_decode<bit_torrent::torrent_metainfo>(torrent_file.view());
 
-        SHA1 hasher {};
-        hasher.update(bit_torrent::bencode_json(torrent_info["info"]));
-
-        std::cout << "Tracker URL: " << torrent_info["announce"].get<std::string>() << '\n';
-        std::cout << "Length: " << torrent_info["info"]["length"] << '\n';
-        std::cout << "Info Hash: " << hasher.final() << '\n';
-        std::cout << "Piece Length: " << torrent_info["info"]["piece length"] << '\n';
+        if (torrent.announce)
+            std::cout << "Tracker URL: " << *torrent.announce << '\n';
+        std::cout << "Length: " << bit_torrent::total_length(torrent.info.value) << '\n';
+        SHA1::digest_type info_hash = compute_info_hash(torrent.info.encoded);
+        std::cout << "Info Hash: " << bit_torrent::byte_view {info_hash.data(), info_hash.size()}.to_hex() << '\n';
+        std::cout << "Piece Length: " << torrent.info.value.piece_length << '\n';
         std::cout << "Piece Hashes:\n";
-        for (const std::string &i : extract_piece_hashes(torrent_info["info"]["pieces"]))
-            std::cout << i << '\n';
+        bit_torrent::piece_hash_table piece_hashes = extract_piece_hashes(torrent.info.value.pieces);
+        for (std::size_t i = 0; i < piece_hashes.size(); ++i)
+            std::cout << piece_hashes.hex(i) << '\n';
     } else if (command == "peers") {
         if (argc < 3) {
             std::cerr << "Usage: " << argv[0] << " peers <file>" << std::endl;
             return 1;
         }
         
-        json torrent_info = decode_bencoded_value(readfile(argv[2]));
+        bit_torrent::mapped_file torrent_file {argv[2]};
+        bit_torrent::torrent_metainfo torrent = bit_torrent::bencode_decode<bit_torrent::torrent_metainfo>(torrent_file.view());
+        if (!torrent.announce)
+            throw std::runtime_error("torrent has no announce url");
 
-        SHA1 hasher {};
-        hasher.update(bit_torrent::bencode_json(torrent_info["info"]));
+        bit_torrent::tracker_response_visitor tracker_info;
+        bit_torrent::tracker_request::request(
+            std::string {*torrent.announce}, compute_info_hash(torrent.info.encoded), std::string (20, '0'), 
+            0, 0, bit_torrent::total_length(torrent.info.value), true, tracker_info);
+        if (tracker_info.failure_reason)
+            throw std::runtime_error("tracker failure: " + *tracker_info.failure_reason);
+        if (!tracker_info.peers)
+            throw std::runtime_error("tracker response doesn't have peers");
 
-        std::string tracker_bencoded_info = bit_torrent::tracker_request::request(
-            torrent_info["announce"].get<std::string>(), hasher.final(), std::string (20, '0'), 
-            0, 0, torrent_info["info"]["length"].get<std::uint64_t>(), true);
-        
-        json tracker_info = decode_bencoded_value(tracker_bencoded_info);
+        bit_torrent::byte_view peers {*tracker_info.peers};
+        if (peers.size() % 6 != 0)
+            throw std::runtime_error("error reading peers, peers size " + std::to_string(peers.size()) + " is not a multiple of 6");
 
-        std::string peers = tracker_info["peers"].get<std::string>();
-        for (int i = 0; i < peers.size()/6; ++i) {
-            std::string address = peers.substr(i*6, 6);
-            if (address.size() != 6)
-                throw std::runtime_error("error reading peers, peer address size is " + std::to_string(address.size()) + " != 6");
+        for (std::size_t i = 0; i < peers.chunk_count(6); ++i) {
+            bit_torrent::byte_view address = peers.chunk(i, 6);
 
             // use inet_ntop ??
             std::ostringstream ip_stream;
             // network order is BE, address[0] is the highest byte, 
             // like in IPv4 presentation format first number is the highest byte
-            ip_stream << (static_cast<unsigned int>(address[0]) & 0xFF) << '.';
-            ip_stream << (static_cast<unsigned int>(address[1]) & 0xFF) << '.';
-            ip_stream << (static_cast<unsigned int>(address[2]) & 0xFF) << '.';
-            ip_stream << (static_cast<unsigned int>(address[3]) & 0xFF);
-            ip_stream << ':' << ntohs(*reinterpret_cast<const std::uint16_t*>(address.c_str()+4));
+            ip_stream << +address[0] << '.';
+            ip_stream << +address[1] << '.';
+            ip_stream << +address[2] << '.';
+            ip_stream << +address[3];
+            ip_stream << ':' << ((address[4] << 8) | address[5]);
             std::cout << ip_stream.str() << '\n';
         }
+    } else if (command == "index") {
+        if (argc < 3) {
+            std::cerr << "Usage: " << argv[0] << " index <dir>" << std::endl;
+            return 1;
+        }
+
+        // one JSON object per line, output is buffered instead of flushed per write
+        std::cout << std::nounitbuf;
+        bit_torrent::index_directory(argv[2], [](const bit_torrent::torrent_index_entry &entry) {
+            json line = {{"path", entry.path}};
+            if (!entry.error.empty()) {
+                line["error"] = entry.error;
+            } else {
+                line["info_hash"] = entry.info_hash;
+                line["length"] = entry.total_length;
+                line["pieces"] = entry.piece_count;
+                line["files"] = entry.files;
+            }
+            // names are not guaranteed to be UTF-8
+            std::cout << line.dump(-1, ' ', false, json::error_handler_t::replace) << '\n';
+        });
+        std::cout << std::flush;
+    } else if (command == "query") {
+        if (argc < 4) {
+            std::cerr << "Usage: " << argv[0] << " query <file> <path>..." << std::endl;
+            return 1;
+        }
+
+        bit_torrent::mapped_file input {argv[2]};
+        std::vector<std::optional<std::string_view>> values;
+        if (argc == 4 || input.view().size() > bit_torrent::bencode_tape::MAX_SOURCE_SIZE) {
+            // a single lookup skips everything off the path without parsing it,
+            // so do inputs too large for a tape, once per path
+            for (int i = 3; i < argc; ++i)
+                values.push_back(bit_torrent::bencode_query(input.view(), argv[i]));
+        } else {
+            // several lookups share one tape, whose key index binary searches every dictionary on the way
+            bit_torrent::bencode_parser parser {};
+            bit_torrent::bencode_tape tape = parser.parse_tape(input.view());
+            tape.index_keys();
+            for (int i = 3; i < argc; ++i) {
+                std::optional<bit_torrent::bencode_tape::node> value = tape.root().query(argv[i]);
+                values.push_back(value ? std::optional {value->raw()} : std::nullopt);
+            }
+        }
+
+        // one JSON value per path, null for missing ones
+        std::cout << std::nounitbuf;
+        bool all_found = true;
+        for (const std::optional<std::string_view> &value : values) {
+            if (value)
+                bit_torrent::bencode_to_json(*value, std::cout);
+            else
+                std::cout << "null\n";
+            all_found = all_found && value;
+        }
+        std::cout << std::flush;
+        if (!all_found)
+            return 2;
+    } else if (command == "create") {
+        if (argc < 3 || argc % 2 == 0) {
+            std::cerr << "Usage: " << argv[0] << " create <path> [--announce <url>] [--piece-length <bytes>] "
+                "[--threads <count>] [--output <file>]" << std::endl;
+            return 1;
+        }
+
+        bit_torrent::torrent_create_options options {};
+        std::string output_path;
+        for (int i = 3; i + 1 < argc; i += 2) {
+            std::string_view option = argv[i];
+            if (option == "--announce")
+                options.announce = argv[i+1];
+            else if (option == "--piece-length")
+                options.piece_length = std::stoll(argv[i+1]);
+            else if (option == "--threads")
+                options.threads = static_cast<unsigned>(std::stoul(argv[i+1]));
+            else if (option == "--output")
+                output_path = argv[i+1];
+            else
+                throw std::runtime_error("unknown option: " + std::string {option});
+        }
+        if (output_path.empty()) {
+            std::filesystem::path root = std::filesystem::path {argv[2]}.lexically_normal();
+            if (!root.has_filename())
+                root = root.parent_path();
+            output_path = root.filename().string() + ".torrent";
+        }
+
+        std::ofstream output {output_path, std::ios::binary};
+        if (!output)
+            throw std::runtime_error("can't create file: " + output_path);
+
+        bit_torrent::streambuf_sink sink {*output.rdbuf()};
+        bit_torrent::torrent_create_result result = bit_torrent::create_torrent(argv[2], options, sink);
+        std::cout << "Created: " << output_path << '\n';
+        std::cout << "Info Hash: " << result.info_hash << '\n';
+        std::cout << "Piece Length: " << result.piece_length << '\n';
+    } else if (command == "verify") {
+        if (argc != 4 && !(argc == 6 && std::string_view {argv[4]} == "--threads")) {
+            std::cerr << "Usage: " << argv[0] << " verify <file> <data path> [--threads <count>]" << std::endl;
+            return 1;
+        }
+
+        unsigned threads = argc == 6 ? static_cast<unsigned>(std::stoul(argv[5])) : 0;
+        bit_torrent::mapped_file torrent_file {argv[2]};
+        bit_torrent::torrent_metainfo torrent = bit_torrent::bencode_decode<bit_torrent::torrent_metainfo>(torrent_file.view());
+
+        auto start = std::chrono::steady_clock::now();
+        bit_torrent::torrent_verify_result result = bit_torrent::verify_torrent(torrent.info.value, argv[3], threads);
+        double seconds = std::chrono::duration<double> {std::chrono::steady_clock::now() - start}.count();
+
+        std::cout << "Pieces: " << result.good_pieces << '/' << result.piece_count << " good\n";
+        std::cout << "Bitfield: " << bit_torrent::byte_view {result.bitfield.data(), result.bitfield.size()}.to_hex() << '\n';
+        std::cout << "Hashed: " << result.bytes_hashed << " bytes in " << seconds << " s ("
+            << (seconds > 0 ? result.bytes_hashed / seconds / (1 << 20) : 0) << " MiB/s, "
+            << result.engine << ")\n";
+        if (result.good_pieces != result.piece_count)
+            return 2;
     }
     
     else {
@@ -0,0 +1,53 @@
+#include <algorithm>
+
+#include "bencode_error.hpp"
+
+
+const char *bit_torrent::to_string(bencode_errc code) {
+    switch (code) {
+    case bencode_errc::ERROR_UNEXPECTED_END:        return "unexpected end of input";
+    case bencode_errc::ERROR_INVALID_VALUE:         return "invalid value start";
+    case bencode_errc::ERROR_KEY_EXPECTED:          return "string as a dictionary key expected";
+    case bencode_errc::ERROR_INVALID_INTEGER:       return "invalid integer";
+    case bencode_errc::ERROR_INTEGER_OUT_OF_RANGE:  return "integer is out of range";
+    case bencode_errc::ERROR_INVALID_STRING_LENGTH: return "invalid string length";
+    case bencode_errc::ERROR_STRING_TOO_LONG:       return "string length is too big";
+    case bencode_errc::ERROR_DEPTH_LIMIT:           return "nesting depth limit exceeded";
+    case bencode_errc::ERROR_ELEMENT_LIMIT:         return "element count limit exceeded";
+    case bencode_errc::ERROR_SIZE_LIMIT:            return "input size limit exceeded";
+    }
+
+    return "unknown error";
+}
+
+
+bit_torrent::bencode_error bit_torrent::bencode_error::at(bencode_errc code, std::string_view source, std::size_t offset) {
+    bencode_error result {code, offset, {}, 0};
+    std::string_view context = source.substr(std::min(offset, source.size()), CONTEXT_SIZE);
+    std::copy(context.begin(), context.end(), result.context_bytes.begin());
+    result.context_size = static_cast<std::uint8_t>(context.size());
+    return result;
+}
+
+
+std::string bit_torrent::bencode_error::message() const {
+    static const char DIGITS[] = "0123456789abcdef";
+
+    std::string result = to_string(code);
+    result += " at offset " + std::to_string(offset);
+    if (context_size == 0)
+        return result;
+
+    result += " near \"";
+    for (char ch : context()) {
+        if (ch >= 0x20 && ch < 0x7F && ch != '"' && ch != '\\') {
+            result.push_back(ch);
+        } else {
+            result += "\\x";
+            result.push_back(DIGITS[(ch >> 4) & 0xF]);
+            result.push_back(DIGITS[ch & 0xF]);
+        }
+    }
+    result.push_back('"');
+    return result;
+}
@@ -0,0 +1,62 @@
+#ifndef BENCODE_ERROR_HPP
+#define BENCODE_ERROR_HPP
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace bit_torrent {
+
+enum class bencode_errc : int {
+    ERROR_UNEXPECTED_END,
+    ERROR_INVALID_VALUE,
+    ERROR_KEY_EXPECTED,
+    ERROR_INVALID_INTEGER,
+    ERROR_INTEGER_OUT_OF_RANGE,
+    ERROR_INVALID_STRING_LENGTH,
+    ERROR_STRING_TOO_LONG,
+    ERROR_DEPTH_LIMIT,
+    ERROR_ELEMENT_LIMIT,
+    ERROR_SIZE_LIMIT
+};
+
+const char *to_string(bencode_errc code);
+
+
+/*
+    Parsing failure with the offset of the offending byte and a copy of a few
+    bytes starting there. It never allocates, so rejecting malformed input
+    costs the same no matter how large the input is.
+*/
+struct bencode_error {
+    static constexpr std::size_t CONTEXT_SIZE = 16;
+
+    bencode_errc code;
+    std::size_t offset;
+    std::array<char, CONTEXT_SIZE> context_bytes;
+    std::uint8_t context_size;
+
+    static bencode_error at(bencode_errc code, std::string_view source, std::size_t offset);
+
+    std::string_view context() const { return {context_bytes.data(), context_size}; }
+    // e.g. "key expected at offset 12 near \"i5e...\"", non-printable bytes are escaped
+    std::string message() const;
+};
+
+
+// thrown by the throwing parse functions
+class bencode_parse_error : public std::runtime_error {
+    bencode_error error_;
+
+public:
+    explicit bencode_parse_error(const bencode_error &error) : 
+        std::runtime_error("parse: " + error.message()), error_(error) {}
+
+    const bencode_error &error() const { return error_; }
+};
+
+}
+
+#endif
@@ -0,0 +1,218 @@
+#ifndef BENCODE_FIXED_HPP
+#define BENCODE_FIXED_HPP
+
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "bencode_schema.hpp"
+#include "bencode_sink.hpp"
+#include "byte_view.hpp"
+
+namespace bit_torrent {
+
+/*
+    Encoder for dictionaries whose keys are known at compile time:
+
+        using ut_metadata_request = bencode_fixed_dict<
+            bencode_fixed_field<"msg_type", std::int64_t>,
+            bencode_fixed_field<"piece", std::int64_t>>;
+
+        std::string message = ut_metadata_request {0, 5}.encode();
+
+    Fields may be declared in any order, they are sorted by key and the
+    encoded keys are built at compile time, so only the values are
+    formatted at runtime. Value types are integers, std::string_view,
+    byte_view, std::optional (the key is left out when empty) and nested
+    bencode_fixed_dict.
+*/
+
+template <fixed_string Key, typename T>
+struct bencode_fixed_field {
+    static constexpr std::string_view key = Key.view();
+    using value_type = T;
+};
+
+
+template <typename... FieldsT>
+class bencode_fixed_dict;
+
+
+namespace detail {
+
+template <typename T> struct is_fixed_dict : std::false_type {};
+template <typename... FieldsT> struct is_fixed_dict<bencode_fixed_dict<FieldsT...>> : std::true_type {};
+
+
+constexpr std::size_t decimal_digits(std::uint64_t value) {
+    std::size_t result = 1;
+    for (; value >= 10; value /= 10)
+        ++result;
+    return result;
+}
+
+
+// "<length>:<key>" of a field, built at compile time
+template <typename FieldT>
+struct encoded_key {
+    static constexpr std::size_t size = decimal_digits(FieldT::key.size()) + 1 + FieldT::key.size();
+
+    static constexpr std::array<char, size> value = [] {
+        std::array<char, size> result {};
+        std::size_t length = FieldT::key.size();
+        std::size_t digits = decimal_digits(length);
+        for (std::size_t i = digits; i != 0; --i, length /= 10)
+            result[i-1] = static_cast<char>('0' + length % 10);
+        result[digits] = ':';
+        std::copy(FieldT::key.begin(), FieldT::key.end(), result.begin() + digits + 1);
+        return result;
+    }();
+};
+
+
+template <typename T>
+std::size_t fixed_value_size(const T &value) {
+    if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool>) {
+        char digits[24];
+        return std::to_chars(digits, digits+sizeof(digits), value).ptr - digits + 2; // i<number>e
+    } else if constexpr (std::is_same_v<T, std::string_view> || std::is_same_v<T, byte_view>) {
+        return decimal_digits(value.size()) + 1 + value.size();
+    } else if constexpr (is_fixed_dict<T>::value) {
+        return value.encoded_size();
+    } else {
+        static_assert(always_false<T>, "bencode_fixed: type has no bencode representation");
+    }
+}
+
+
+template <typename T>
+char *write_fixed_value(char *out, const T &value) {
+    if constexpr (std::is_integral_v<T>) {
+        *out++ = 'i';
+        out = std::to_chars(out, out+24, value).ptr;
+        *out++ = 'e';
+        return out;
+    } else if constexpr (std::is_same_v<T, std::string_view> || std::is_same_v<T, byte_view>) {
+        out = std::to_chars(out, out+24, value.size()).ptr;
+        *out++ = ':';
+        std::memcpy(out, value.data(), value.size());
+        return out + value.size();
+    } else {
+        return value.encode_to(out);
+    }
+}
+
+}
+
+
+template <typename... FieldsT>
+class bencode_fixed_dict {
+    static constexpr std::size_t FIELD_COUNT = sizeof...(FieldsT);
+
+    // field indices in the order of their keys
+    static constexpr std::array<std::size_t, FIELD_COUNT> order = [] {
+        std::array<std::string_view, FIELD_COUNT> keys {FieldsT::key...};
+        std::array<std::size_t, FIELD_COUNT> result {};
+        for (std::size_t i = 0; i < FIELD_COUNT; ++i)
+            result[i] = i;
+
+        for (std::size_t i = 1; i < FIELD_COUNT; ++i)
+            for (std::size_t j = i; j != 0 && keys[result[j]] < keys[result[j-1]]; --j)
+                std::swap(result[j], result[j-1]);
+
+        for (std::size_t i = 1; i < FIELD_COUNT; ++i)
+            if (keys[result[i]] == keys[result[i-1]])
+                throw std::logic_error("bencode_fixed: duplicate key");
+
+        return result;
+    }();
+
+    using fields = std::tuple<FieldsT...>;
+
+    std::tuple<typename FieldsT::value_type...> values_;
+
+    template <std::size_t I>
+    std::size_t field_size() const {
+        using field = std::tuple_element_t<I, fields>;
+        const auto &value = std::get<I>(values_);
+        if constexpr (detail::is_optional<typename field::value_type>::value)
+            return value ? detail::encoded_key<field>::size + detail::fixed_value_size(*value) : 0;
+        else
+            return detail::encoded_key<field>::size + detail::fixed_value_size(value);
+    }
+
+    template <std::size_t I>
+    char *write_field(char *out) const {
+        using field = std::tuple_element_t<I, fields>;
+        using key = detail::encoded_key<field>;
+        const auto &value = std::get<I>(values_);
+        if constexpr (detail::is_optional<typename field::value_type>::value) {
+            if (!value)
+                return out;
+            std::memcpy(out, key::value.data(), key::size);
+            return detail::write_fixed_value(out + key::size, *value);
+        } else {
+            std::memcpy(out, key::value.data(), key::size);
+            return detail::write_fixed_value(out + key::size, value);
+        }
+    }
+
+    template <std::size_t... I>
+    std::size_t fields_size(std::index_sequence<I...>) const {
+        return (field_size<order[I]>() + ... + 0);
+    }
+
+    template <std::size_t... I>
+    char *write_fields(char *out, std::index_sequence<I...>) const {
+        ((out = write_field<order[I]>(out)), ...);
+        return out;
+    }
+
+public:
+    bencode_fixed_dict(typename FieldsT::value_type... values) : values_(std::move(values)...) {}
+
+    std::size_t encoded_size() const {
+        return 2 + fields_size(std::index_sequence_for<FieldsT...> {}); // d...e
+    }
+
+    // writes exactly encoded_size() bytes, returns the end of the written bytes
+    char *encode_to(char *out) const {
+        *out++ = 'd';
+        out = write_fields(out, std::index_sequence_for<FieldsT...> {});
+        *out++ = 'e';
+        return out;
+    }
+
+    std::string encode() const {
+        std::string result;
+        result.resize_and_overwrite(encoded_size(), [this](char *out, std::size_t) {
+            return encode_to(out) - out;
+        });
+        return result;
+    }
+
+    // short messages are formatted on the stack, longer ones through one allocation
+    void encode(bencode_sink &sink) const {
+        std::array<char, 512> buffer;
+        if (std::size_t size = encoded_size(); size <= buffer.size()) {
+            encode_to(buffer.data());
+            sink.write(buffer.data(), size);
+            return;
+        }
+
+        std::string encoded = encode();
+        sink.write(encoded.data(), encoded.size());
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,70 @@
+#include "bencode_json_builder.hpp"
+
+using json = nlohmann::json;
+
+
+json *bit_torrent::bencode_json_builder::insert(json value) {
+    if (containers_.empty()) {
+        result_ = std::move(value);
+        return &result_;
+    }
+
+    json &parent = *containers_.back();
+    if (parent.is_array()) {
+        parent.push_back(std::move(value));
+        return &parent.back();
+    }
+
+    json &slot = parent[key_];
+    slot = std::move(value);
+    return &slot;
+}
+
+
+bool bit_torrent::bencode_json_builder::on_integer(std::int64_t value) {
+    insert(json(value));
+    return true;
+}
+
+
+bool bit_torrent::bencode_json_builder::on_string(std::string_view value) {
+    if (storage_ == string_storage::STORAGE_STRING) {
+        insert(json(value));
+        return true;
+    }
+
+    const std::uint8_t *bytes = reinterpret_cast<const std::uint8_t*>(value.data());
+    insert(json::binary(json::binary_t::container_type(bytes, bytes+value.size())));
+    return true;
+}
+
+
+bool bit_torrent::bencode_json_builder::on_list_begin() {
+    // the parent is not modified until this list is closed, so the pointer stays valid
+    containers_.push_back(insert(json::array()));
+    return true;
+}
+
+
+bool bit_torrent::bencode_json_builder::on_list_end() {
+    containers_.pop_back();
+    return true;
+}
+
+
+bool bit_torrent::bencode_json_builder::on_dictionary_begin() {
+    containers_.push_back(insert(json::object()));
+    return true;
+}
+
+
+bool bit_torrent::bencode_json_builder::on_dictionary_key(std::string_view key) {
+    key_ = key;
+    return true;
+}
+
+
+bool bit_torrent::bencode_json_builder::on_dictionary_end() {
+    containers_.pop_back();
+    return true;
+}
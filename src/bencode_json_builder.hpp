@@ -0,0 +1,44 @@
+#ifndef BENCODE_JSON_BUILDER_HPP
+#define BENCODE_JSON_BUILDER_HPP
+
+#include <string>
+#include <vector>
+
+#include "lib/nlohmann/json.hpp"
+#include "bencode_visitor.hpp"
+
+namespace bit_torrent {
+
+// how byte string values are stored in the json tree
+enum class string_storage : int {
+    STORAGE_STRING, // json string, so get<std::string>() works, dump() throws on invalid UTF-8
+    STORAGE_BINARY  // json binary, never UTF-8 validated by dump()
+};
+
+
+// builds the nlohmann::json tree of bencode_parser::parse from visitor events
+class bencode_json_builder final : public bencode_visitor {
+    string_storage storage_;
+    nlohmann::json result_;
+    std::vector<nlohmann::json*> containers_;
+    std::string key_;
+
+    nlohmann::json *insert(nlohmann::json value);
+
+public:
+    explicit bencode_json_builder(string_storage storage = string_storage::STORAGE_STRING) : storage_(storage) {}
+
+    bool on_integer(std::int64_t value) override;
+    bool on_string(std::string_view value) override;
+    bool on_list_begin() override;
+    bool on_list_end() override;
+    bool on_dictionary_begin() override;
+    bool on_dictionary_key(std::string_view key) override;
+    bool on_dictionary_end() override;
+
+    nlohmann::json &result() { return result_; }
+};
+
+}
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef BENCODE_LIMITS_HPP
+#define BENCODE_LIMITS_HPP
+
+#include <cstddef>
+#include <limits>
+
+namespace bit_torrent {
+
+// hard bounds for parsing untrusted input, exceeding any of them is a parse error
+struct bencode_limits {
+    std::size_t max_depth = 256;                                       // nested lists and dictionaries
+    std::size_t max_elements = std::numeric_limits<std::size_t>::max(); // values, dictionary keys not counted
+    std::size_t max_bytes = std::numeric_limits<std::size_t>::max();    // encoded input size
+};
+
+}
+
+#endif
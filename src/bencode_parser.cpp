@@ -1,102 +1,402 @@
+#include <algorithm>
+
+#include "bencode_json_builder.hpp"
 #include "bencode_parser.hpp"
+#include "bencode_scan.hpp"
 
 using json = nlohmann::json;
 
-json bit_torrent::bencode_parser::parse(const std::string &source) {
-    remains_ = std::string_view {source};
-    return parse_advance_detected();
+namespace {
+
+// initial capacity of the parsing stack, deeper documents grow it up to the depth limit
+const std::size_t PREALLOCATED_DEPTH = 64;
+
+
+template <typename T>
+T unwrap(std::expected<T, bit_torrent::bencode_error> result) {
+    if (!result)
+        throw bit_torrent::bencode_parse_error(result.error());
+
+    return std::move(*result);
 }
 
 
-json bit_torrent::bencode_parser::parse_advance_string() {
-    assert(std::isdigit(remains_.front()));
+// forwards parser events to a bencode_visitor, offsets are dropped
+template <typename VisitorT>
+class visitor_handler {
+    VisitorT &visitor_;
 
-    std::size_t colon_idx = remains_.find(':');
-    if (colon_idx == std::string_view::npos)
-        throw std::runtime_error {"parse_string: invalid string format at: " + std::string{remains_}};
-    
-    int64_t charcount = std::stoll(std::string{remains_.substr(0, colon_idx)});
-    
-    if (remains_.size() < charcount+colon_idx+1)
-        throw std::runtime_error("parse_string: not enough chars in string");
+public:
+    explicit visitor_handler(VisitorT &visitor) : visitor_(visitor) {}
+
+    bool on_integer(std::int64_t value, std::size_t, std::size_t) { return visitor_.on_integer(value); }
+    bool on_string(std::string_view value, std::size_t, std::size_t) { return visitor_.on_string(value); }
+    bool on_list_begin(std::size_t) { return visitor_.on_list_begin(); }
+    bool on_list_end(std::size_t) { return visitor_.on_list_end(); }
+    bool on_dictionary_begin(std::size_t) { return visitor_.on_dictionary_begin(); }
+    bool on_dictionary_key(std::string_view key, std::size_t, std::size_t) { return visitor_.on_dictionary_key(key); }
+    bool on_dictionary_end(std::size_t) { return visitor_.on_dictionary_end(); }
+};
+
+
+// offsets fit into 32 bits, try_parse_tape() checks the source size first
+class tape_handler {
+    std::vector<bit_torrent::bencode_tape::entry> &entries_;
+    std::vector<std::size_t> open_; // indices of unfinished container entries
+
+    void count_element() {
+        if (!open_.empty())
+            ++entries_[open_.back()].value;
+    }
+
+    void push(std::size_t begin, std::size_t end, std::size_t value) {
+        entries_.push_back({static_cast<std::uint32_t>(begin), static_cast<std::uint32_t>(end), 
+            static_cast<std::uint32_t>(entries_.size()+1), static_cast<std::uint32_t>(value)});
+    }
 
-    std::string result_string = std::string {remains_.substr(colon_idx+1, charcount)};
+    bool open(std::size_t begin) {
+        count_element();
+        open_.push_back(entries_.size());
+        push(begin, 0, 0);
+        return true;
+    }
+
+    bool close(std::size_t end) {
+        // entries_ could be reallocated by nested values, so no references are kept
+        entries_[open_.back()].end = static_cast<std::uint32_t>(end);
+        entries_[open_.back()].next = static_cast<std::uint32_t>(entries_.size());
+        open_.pop_back();
+        return true;
+    }
+
+public:
+    explicit tape_handler(std::vector<bit_torrent::bencode_tape::entry> &entries) : entries_(entries) {}
+
+    bool on_integer(std::int64_t, std::size_t begin, std::size_t end) {
+        count_element();
+        push(begin, end, 0); // decoded from the source on access
+        return true;
+    }
+
+    bool on_string(std::string_view value, std::size_t begin, std::size_t end) {
+        count_element();
+        push(begin, end, end-value.size());
+        return true;
+    }
+
+    bool on_dictionary_key(std::string_view key, std::size_t begin, std::size_t end) {
+        // keys are not counted, dictionary size is the number of pairs
+        push(begin, end, end-key.size());
+        return true;
+    }
+
+    bool on_list_begin(std::size_t begin) { return open(begin); }
+    bool on_list_end(std::size_t end) { return close(end); }
+    bool on_dictionary_begin(std::size_t begin) { return open(begin); }
+    bool on_dictionary_end(std::size_t end) { return close(end); }
+};
+
+
+class document_handler {
+    using bencode_value = bit_torrent::bencode_value;
+
+    struct open_container {
+        bool is_list;
+        bencode_value::list_type list;
+        bencode_value::dictionary_type dictionary;
+        std::string_view key;
+    };
 
-    remains_.remove_prefix(std::min(colon_idx+1+charcount, remains_.size()));
+    std::pmr::memory_resource *resource_;
+    std::vector<open_container> open_;
+    bencode_value root_;
+
+    bool insert(bencode_value value) {
+        if (open_.empty())
+            root_ = std::move(value);
+        else if (open_.back().is_list)
+            open_.back().list.push_back(std::move(value));
+        else
+            open_.back().dictionary.emplace_back(open_.back().key, std::move(value));
+        return true;
+    }
+
+    bool open(bool is_list) {
+        open_.push_back({is_list, bencode_value::list_type {resource_}, bencode_value::dictionary_type {resource_}, {}});
+        return true;
+    }
+
+public:
+    explicit document_handler(std::pmr::memory_resource *resource) : resource_(resource) {}
+
+    bool on_integer(std::int64_t value, std::size_t, std::size_t) { return insert(bencode_value {value}); }
+    bool on_string(std::string_view value, std::size_t, std::size_t) { return insert(bencode_value {value}); }
+    bool on_list_begin(std::size_t) { return open(true); }
+    bool on_dictionary_begin(std::size_t) { return open(false); }
+
+    bool on_dictionary_key(std::string_view key, std::size_t, std::size_t) {
+        open_.back().key = key;
+        return true;
+    }
+
+    bool on_list_end(std::size_t) {
+        bencode_value result {std::move(open_.back().list)};
+        open_.pop_back();
+        return insert(std::move(result));
+    }
+
+    bool on_dictionary_end(std::size_t) {
+        bencode_value result {std::move(open_.back().dictionary)};
+        open_.pop_back();
+        return insert(std::move(result));
+    }
+
+    bencode_value &result() { return root_; }
+};
 
-    return json(result_string);
 }
 
 
-json bit_torrent::bencode_parser::parse_advance_integer() {
-    assert(remains_.front() == 'i');
+bit_torrent::bencode_parser::bencode_parser(bencode_limits limits) : limits_(limits) {
+    stack_.reserve(std::min(limits_.max_depth, PREALLOCATED_DEPTH));
+}
 
-    std::size_t end_idx = remains_.find('e');
-    if (end_idx == std::string_view::npos)
-        throw std::runtime_error {"parse_integer: ending symbol 'e' not found at: " + std::string{remains_}};
-    
-    int64_t number = std::stoll(std::string{remains_.substr(1, end_idx-1)}); // from 1 because of 'i'
 
-    remains_.remove_prefix(end_idx+1);
-    return json(number);
+json bit_torrent::bencode_parser::parse(std::string_view source, string_storage storage) {
+    return unwrap(try_parse(source, storage));
 }
 
 
-json bit_torrent::bencode_parser::parse_advance_list() {
-    assert(remains_.front() == 'l');
+bit_torrent::bencode_tape bit_torrent::bencode_parser::parse_tape(std::string_view source) {
+    return unwrap(try_parse_tape(source));
+}
+
+
+bit_torrent::bencode_document bit_torrent::bencode_parser::parse_document(std::string_view source) {
+    return unwrap(try_parse_document(source));
+}
+
+
+bool bit_torrent::bencode_parser::parse(std::string_view source, bencode_visitor &visitor) {
+    return unwrap(try_parse(source, visitor));
+}
+
+
+std::expected<json, bit_torrent::bencode_error> bit_torrent::bencode_parser::try_parse(std::string_view source,
+        string_storage storage) {
+    bencode_json_builder builder {storage};
+    visitor_handler<bencode_json_builder> handler {builder};
+    if (auto status = run(source, handler); !status)
+        return std::unexpected(status.error());
+
+    return std::move(builder.result());
+}
+
+
+std::expected<bit_torrent::bencode_tape, bit_torrent::bencode_error> 
+bit_torrent::bencode_parser::try_parse_tape(std::string_view source) {
+    if (source.size() > bencode_tape::MAX_SOURCE_SIZE)
+        return std::unexpected(bencode_error::at(bencode_errc::ERROR_SIZE_LIMIT, source, bencode_tape::MAX_SOURCE_SIZE));
+
+    bencode_tape result {};
+    result.source_ = source;
+    tape_handler handler {result.entries_};
+    if (auto status = run(source, handler); !status)
+        return std::unexpected(status.error());
 
-    remains_.remove_prefix(1); // removing 'l'
-    json result = json::array();
-    while (!remains_.empty() && remains_.front() != 'e') 
-        result.push_back(parse_advance_detected());
-    
-    if (remains_.empty())
-        throw std::runtime_error {"parse_list: list ending 'e' wasn't found"};
-    
-    remains_.remove_prefix(1); // removing 'e'
     return result;
-}   
+}
+
+
+std::expected<bit_torrent::bencode_document, bit_torrent::bencode_error> 
+bit_torrent::bencode_parser::try_parse_document(std::string_view source) {
+    bencode_document result {};
+    document_handler handler {result.resource()};
+    if (auto status = run(source, handler); !status)
+        return std::unexpected(status.error());
+
+    result.set_root(std::move(handler.result()));
+    return result;
+}
+
+
+std::expected<bool, bit_torrent::bencode_error> 
+bit_torrent::bencode_parser::try_parse(std::string_view source, bencode_visitor &visitor) {
+    visitor_handler<bencode_visitor> handler {visitor};
+    return run(source, handler);
+}
+
+
+std::expected<void, bit_torrent::bencode_error> bit_torrent::bencode_parser::start(std::string_view source) {
+    source_ = remains_ = source;
+    stack_.clear();
+
+    if (source.size() > limits_.max_bytes)
+        return std::unexpected(bencode_error::at(bencode_errc::ERROR_SIZE_LIMIT, source, limits_.max_bytes));
+
+    return {};
+}
+
+
+template <typename HandlerT>
+std::expected<bool, bit_torrent::bencode_error> bit_torrent::bencode_parser::run(std::string_view source, HandlerT &handler) {
+    if (auto started = start(source); !started)
+        return std::unexpected(started.error());
+
+    return walk(handler);
+}
+
+
+/*
+    Walks one value with an explicit stack instead of recursion, so hostile
+    nesting hits max_depth instead of the end of the call stack.
+*/
+template <typename HandlerT>
+std::expected<bool, bit_torrent::bencode_error> bit_torrent::bencode_parser::walk(HandlerT &handler) {
+    std::size_t elements = 0;
+    while (true) {
+        if (!stack_.empty()) {
+            bencode_types top = stack_.back();
+            if (remains_.empty())
+                return fail(bencode_errc::ERROR_UNEXPECTED_END);
+
+            if (remains_.front() == 'e') {
+                remains_.remove_prefix(1); // removing 'e'
+                stack_.pop_back();
+
+                bool proceed;
+                if (top == bencode_types::TYPE_LIST)
+                    proceed = handler.on_list_end(current_offset());
+                else
+                    proceed = handler.on_dictionary_end(current_offset());
+                if (!proceed)
+                    return false;
+
+                if (stack_.empty())
+                    return true;
+                continue;
+            }
+
+            if (top == bencode_types::TYPE_DICT) {
+                if (detect_current_type() != bencode_types::TYPE_STRING)
+                    return fail(remains_.empty() ? bencode_errc::ERROR_UNEXPECTED_END : bencode_errc::ERROR_KEY_EXPECTED);
+
+                std::size_t key_begin = current_offset();
+                std::expected<std::string_view, bencode_error> key_read = read_advance_string();
+                if (!key_read)
+                    return std::unexpected(key_read.error());
+
+                if (!handler.on_dictionary_key(*key_read, key_begin, current_offset()))
+                    return false;
+            }
+        }
 
+        if (++elements > limits_.max_elements)
+            return fail(bencode_errc::ERROR_ELEMENT_LIMIT);
 
-json bit_torrent::bencode_parser::parse_advance_dictionary() {
-    assert(remains_.front() == 'd');
+        std::size_t value_begin = current_offset();
+        bool proceed;
+        switch (bencode_types type = detect_current_type()) {
+        case bencode_types::TYPE_STRING: {
+            std::expected<std::string_view, bencode_error> value = read_advance_string();
+            if (!value)
+                return std::unexpected(value.error());
+            proceed = handler.on_string(*value, value_begin, current_offset());
+            break;
+        }
 
-    remains_.remove_prefix(1); // removing 'd'
-    json result = json::object();
-    while (!remains_.empty() && remains_.front() != 'e') {
-        if (detect_current_type() != bencode_types::TYPE_STRING)
-            throw std::runtime_error {"parse_dictionary: string as a key expected: " + std::string{remains_}};
-        
-        json key = parse_advance_string();
-        json value = parse_advance_detected();
+        case bencode_types::TYPE_INT: {
+            std::expected<std::int64_t, bencode_error> value = read_advance_integer();
+            if (!value)
+                return std::unexpected(value.error());
+            proceed = handler.on_integer(*value, value_begin, current_offset());
+            break;
+        }
 
-        result[key] = value;
+        case bencode_types::TYPE_LIST:
+        case bencode_types::TYPE_DICT:
+            if (stack_.size() == limits_.max_depth)
+                return fail(bencode_errc::ERROR_DEPTH_LIMIT);
+
+            remains_.remove_prefix(1); // removing 'l' or 'd'
+            stack_.push_back(type);
+            if (type == bencode_types::TYPE_LIST)
+                proceed = handler.on_list_begin(value_begin);
+            else
+                proceed = handler.on_dictionary_begin(value_begin);
+
+            if (!proceed)
+                return false;
+            continue;
+
+        default:
+            return fail(remains_.empty() ? bencode_errc::ERROR_UNEXPECTED_END : bencode_errc::ERROR_INVALID_VALUE);
+        }
+
+        if (!proceed)
+            return false;
+
+        if (stack_.empty())
+            return true;
     }
+}
 
-    if (remains_.empty())
-        throw std::runtime_error {"parse_dictionary: dictionary ending 'e' wasn't found"};
-    
-    remains_.remove_prefix(1); // removing 'e'
-    return result;
+
+std::expected<std::string_view, bit_torrent::bencode_error> bit_torrent::bencode_parser::read_advance_string() {
+    assert(std::isdigit(remains_.front()));
+
+    std::string_view result_string;
+    std::size_t length;
+    switch (scan_string(remains_, result_string, length)) {
+    case scan_status::SCAN_OK:
+        break;
+
+    case scan_status::SCAN_OUT_OF_RANGE:
+        return fail(bencode_errc::ERROR_STRING_TOO_LONG);
+
+    case scan_status::SCAN_TRUNCATED:
+        return fail(bencode_errc::ERROR_UNEXPECTED_END);
+
+    default:
+        return fail(bencode_errc::ERROR_INVALID_STRING_LENGTH);
+    }
+
+    remains_.remove_prefix(length);
+    return result_string;
 }
 
 
-json bit_torrent::bencode_parser::parse_advance_detected() {
-    switch (detect_current_type()) {
-    case bencode_types::TYPE_STRING:
-        return parse_advance_string();
-    
-    case bencode_types::TYPE_INT:
-        return parse_advance_integer();
+std::expected<std::int64_t, bit_torrent::bencode_error> bit_torrent::bencode_parser::read_advance_integer() {
+    assert(remains_.front() == 'i');
 
-    case bencode_types::TYPE_LIST:
-        return parse_advance_list();
+    std::int64_t number;
+    std::size_t length;
+    switch (scan_integer(remains_, number, length)) {
+    case scan_status::SCAN_OK:
+        break;
+
+    case scan_status::SCAN_OUT_OF_RANGE:
+        return fail(bencode_errc::ERROR_INTEGER_OUT_OF_RANGE);
+
+    case scan_status::SCAN_TRUNCATED:
+        return fail(bencode_errc::ERROR_UNEXPECTED_END);
+
+    default:
+        return fail(bencode_errc::ERROR_INVALID_INTEGER);
+    }
+
+    remains_.remove_prefix(length);
+    return number;
+}
+
+
+std::unexpected<bit_torrent::bencode_error> bit_torrent::bencode_parser::fail(bencode_errc code) const {
+    return std::unexpected(bencode_error::at(code, source_, current_offset()));
+}
 
-    case bencode_types::TYPE_DICT:
-        return parse_advance_dictionary();
-    };
 
-    throw std::runtime_error {"parse_detected: invalid string format: " + std::string{remains_}};
+std::size_t bit_torrent::bencode_parser::current_offset() const {
+    return remains_.data() - source_.data();
 }
 
 
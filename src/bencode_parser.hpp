@@ -1,14 +1,21 @@
 #ifndef BENCODE_PARSER_HPP
 #define BENCODE_PARSER_HPP
 
+#include <expected>
 #include <string>
+#include <string_view>
+#include <vector>
 #include "lib/nlohmann/json.hpp"
+#include "bencode_error.hpp"
+#include "bencode_json_builder.hpp"
+#include "bencode_limits.hpp"
+#include "bencode_tape.hpp"
+#include "bencode_value.hpp"
+#include "bencode_visitor.hpp"
 
 namespace bit_torrent {
 
 class bencode_parser {
-    std::string_view remains_;
-
     enum class bencode_types : int {
         TYPE_NONE = -1,
         TYPE_STRING,
@@ -17,18 +24,49 @@ class bencode_parser {
         TYPE_DICT
     };
 
-    nlohmann::json parse_advance_integer();
-    nlohmann::json parse_advance_string();
-    nlohmann::json parse_advance_list();
-    nlohmann::json parse_advance_dictionary();
-    nlohmann::json parse_advance_detected();
+    bencode_limits limits_;
+    std::vector<bencode_types> stack_; // open containers, the explicit parsing stack
+
+    std::string_view source_;
+    std::string_view remains_;
+
+    std::expected<void, bencode_error> start(std::string_view source);
+    template <typename HandlerT>
+    std::expected<bool, bencode_error> walk(HandlerT &handler);
+    template <typename HandlerT>
+    std::expected<bool, bencode_error> run(std::string_view source, HandlerT &handler);
+
+    std::expected<std::string_view, bencode_error> read_advance_string();
+    std::expected<std::int64_t, bencode_error> read_advance_integer();
+    std::unexpected<bencode_error> fail(bencode_errc code) const;
 
     bencode_types detect_current_type() const;
+    std::size_t current_offset() const;
 
 public:
-    nlohmann::json parse(const std::string &encoded);
+    explicit bencode_parser(bencode_limits limits = {});
+
+    // byte strings become json strings unless STORAGE_BINARY is asked for
+    nlohmann::json parse(std::string_view encoded, string_storage storage = string_storage::STORAGE_STRING);
+
+    // zero-copy mode, the tape references encoded instead of copying strings
+    bencode_tape parse_tape(std::string_view encoded);
+
+    // native mode, every node is allocated from the document arena, strings reference encoded
+    bencode_document parse_document(std::string_view encoded);
+
+    // event-driven mode, returns false if the visitor stopped the parsing
+    bool parse(std::string_view encoded, bencode_visitor &visitor);
+
+    // non-throwing versions of the modes above, malformed input is reported
+    // as a bencode_error instead of a bencode_parse_error exception
+    std::expected<nlohmann::json, bencode_error> try_parse(std::string_view encoded,
+        string_storage storage = string_storage::STORAGE_STRING);
+    std::expected<bencode_tape, bencode_error> try_parse_tape(std::string_view encoded);
+    std::expected<bencode_document, bencode_error> try_parse_document(std::string_view encoded);
+    std::expected<bool, bencode_error> try_parse(std::string_view encoded, bencode_visitor &visitor);
 };
 
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,300 @@
+#include <charconv>
+#include <type_traits>
+
+#include "bencode_push_parser.hpp"
+#include "bencode_scan.hpp"
+
+namespace {
+
+// longest decimal representation of int64_t including sign
+const std::size_t MAX_NUMBER_DIGITS = 20;
+// with the leading 'i'
+const std::size_t MAX_INTEGER_TOKEN = MAX_NUMBER_DIGITS+1;
+
+
+template <typename T>
+T unwrap(std::expected<T, bit_torrent::bencode_error> result) {
+    if (!result)
+        throw bit_torrent::bencode_parse_error(result.error());
+
+    if constexpr (!std::is_void_v<T>)
+        return std::move(*result);
+}
+
+
+std::size_t count_chunk_digits(std::string_view chunk, std::size_t idx) {
+    return bit_torrent::count_digits(chunk.data()+idx, chunk.data()+chunk.size());
+}
+
+}
+
+
+bit_torrent::bencode_push_parser::bencode_push_parser(bencode_visitor &visitor, bencode_limits limits) : 
+    visitor_(visitor), limits_(limits) {}
+
+
+void bit_torrent::bencode_push_parser::reset() {
+    state_ = parser_state::STATE_VALUE;
+    containers_.clear();
+    token_.clear();
+    token_start_ = 0;
+    string_size_ = 0;
+    string_remains_ = 0;
+    stopped_ = false;
+    bytes_consumed_ = 0;
+    elements_ = 0;
+}
+
+
+std::expected<std::size_t, bit_torrent::bencode_error> bit_torrent::bencode_push_parser::try_feed(std::string_view chunk) {
+    // never look past the byte limit, the rest of the chunk is rejected below
+    std::size_t budget = limits_.max_bytes - bytes_consumed_;
+    std::string_view full_chunk = chunk;
+    chunk = chunk.substr(0, budget);
+
+    std::size_t consumed = 0;
+    while (consumed < chunk.size() && !done() && !stopped_) {
+        std::string_view rest = chunk.substr(consumed);
+        std::expected<std::size_t, bencode_error> step;
+        switch (state_) {
+        case parser_state::STATE_VALUE:
+            step = consume_value_start(rest);
+            break;
+
+        case parser_state::STATE_INTEGER:
+            step = consume_integer(rest);
+            break;
+
+        case parser_state::STATE_STRING_LENGTH:
+            step = consume_string_length(rest);
+            break;
+
+        case parser_state::STATE_STRING_PAYLOAD:
+            step = consume_string_payload(rest);
+            break;
+
+        case parser_state::STATE_DONE:
+            step = 0;
+            break;
+        }
+
+        if (!step)
+            return std::unexpected(step.error());
+        consumed += *step;
+        bytes_consumed_ += *step;
+    }
+
+    if (consumed == budget && budget < full_chunk.size() && !done() && !stopped_)
+        return fail(bencode_errc::ERROR_SIZE_LIMIT, full_chunk.substr(consumed), 0);
+
+    return consumed;
+}
+
+
+std::size_t bit_torrent::bencode_push_parser::feed(std::string_view chunk) {
+    return unwrap(try_feed(chunk));
+}
+
+
+std::expected<void, bit_torrent::bencode_error> bit_torrent::bencode_push_parser::try_finish() const {
+    if (done() || stopped_)
+        return {};
+
+    return fail(bencode_errc::ERROR_UNEXPECTED_END, {}, 0);
+}
+
+
+void bit_torrent::bencode_push_parser::finish() const {
+    unwrap(try_finish());
+}
+
+
+std::expected<std::size_t, bit_torrent::bencode_error> bit_torrent::bencode_push_parser::consume_value_start(std::string_view chunk) {
+    char ch = chunk.front();
+    if (ch >= '0' && ch <= '9') {
+        if (!expects_key() && ++elements_ > limits_.max_elements)
+            return fail(bencode_errc::ERROR_ELEMENT_LIMIT, chunk, 0);
+
+        token_.clear();
+        token_start_ = bytes_consumed_;
+        state_ = parser_state::STATE_STRING_LENGTH;
+        return 0; // digits are consumed as the string length
+    }
+
+    if (ch == 'e') {
+        // a stray 'e' or a dictionary key without a value
+        if (containers_.empty() || containers_.back() == container_state::CONTAINER_DICT_VALUE)
+            return fail(bencode_errc::ERROR_INVALID_VALUE, chunk, 0);
+
+        bool is_list = containers_.back() == container_state::CONTAINER_LIST;
+        containers_.pop_back();
+        stopped_ = !(is_list ? visitor_.on_list_end() : visitor_.on_dictionary_end());
+        value_completed();
+        return 1;
+    }
+
+    if (expects_key())
+        return fail(bencode_errc::ERROR_KEY_EXPECTED, chunk, 0);
+
+    if (ch != 'i' && ch != 'l' && ch != 'd')
+        return fail(bencode_errc::ERROR_INVALID_VALUE, chunk, 0);
+
+    if (++elements_ > limits_.max_elements)
+        return fail(bencode_errc::ERROR_ELEMENT_LIMIT, chunk, 0);
+
+    if (ch != 'i' && containers_.size() == limits_.max_depth)
+        return fail(bencode_errc::ERROR_DEPTH_LIMIT, chunk, 0);
+
+    if (ch == 'i') {
+        token_.clear();
+        token_start_ = bytes_consumed_;
+        state_ = parser_state::STATE_INTEGER;
+        return 0; // 'i' is kept in the token for error reporting
+    }
+
+    if (ch == 'l') {
+        containers_.push_back(container_state::CONTAINER_LIST);
+        stopped_ = !visitor_.on_list_begin();
+    } else {
+        containers_.push_back(container_state::CONTAINER_DICT_KEY);
+        stopped_ = !visitor_.on_dictionary_begin();
+    }
+
+    return 1;
+}
+
+
+std::expected<std::size_t, bit_torrent::bencode_error> bit_torrent::bencode_push_parser::consume_integer(std::string_view chunk) {
+    std::size_t digits_idx = token_.empty() ? 1 : 0; // 'i'
+    if (token_.size() + digits_idx == 1 && digits_idx < chunk.size() && chunk[digits_idx] == '-')
+        ++digits_idx;
+
+    std::size_t end_idx = digits_idx + count_chunk_digits(chunk, digits_idx);
+    if (token_.size() + end_idx > MAX_INTEGER_TOKEN)
+        return fail_token(bencode_errc::ERROR_INTEGER_OUT_OF_RANGE, chunk);
+
+    token_.append(chunk.substr(0, end_idx));
+    if (end_idx == chunk.size())
+        return chunk.size();
+
+    // "ie" and "i-e" have no digits
+    if (chunk[end_idx] != 'e' || token_ == "i" || token_ == "i-")
+        return fail_token(bencode_errc::ERROR_INVALID_INTEGER, chunk);
+
+    std::int64_t number;
+    auto [ptr, ec] = std::from_chars(token_.data()+1, token_.data()+token_.size(), number);
+    if (ec != std::errc{})
+        return fail_token(bencode_errc::ERROR_INTEGER_OUT_OF_RANGE, chunk);
+
+    stopped_ = !visitor_.on_integer(number);
+    value_completed();
+    return end_idx+1; // with 'e'
+}
+
+
+std::expected<std::size_t, bit_torrent::bencode_error> bit_torrent::bencode_push_parser::consume_string_length(std::string_view chunk) {
+    std::size_t colon_idx = count_chunk_digits(chunk, 0);
+    if (token_.size() + colon_idx > MAX_NUMBER_DIGITS)
+        return fail_token(bencode_errc::ERROR_STRING_TOO_LONG, chunk);
+
+    token_.append(chunk.substr(0, colon_idx));
+    if (colon_idx == chunk.size())
+        return chunk.size();
+
+    if (chunk[colon_idx] != ':')
+        return fail_token(bencode_errc::ERROR_INVALID_STRING_LENGTH, chunk);
+
+    auto [ptr, ec] = std::from_chars(token_.data(), token_.data()+token_.size(), string_size_);
+    if (ec != std::errc{})
+        return fail_token(bencode_errc::ERROR_STRING_TOO_LONG, chunk);
+
+    string_remains_ = string_size_;
+    token_.clear();
+    if (string_remains_ == 0)
+        emit_string({});
+    else
+        state_ = parser_state::STATE_STRING_PAYLOAD;
+
+    return colon_idx+1; // with ':'
+}
+
+
+std::unexpected<bit_torrent::bencode_error> bit_torrent::bencode_push_parser::fail(bencode_errc code, std::string_view chunk, std::size_t idx) const {
+    bencode_error error = bencode_error::at(code, chunk, idx);
+    error.offset = bytes_consumed_ + idx;
+    return std::unexpected(error);
+}
+
+
+std::unexpected<bit_torrent::bencode_error> bit_torrent::bencode_push_parser::fail_token(bencode_errc code, std::string_view chunk) const {
+    // reported from the token start like bencode_parser does
+    if (token_start_ >= bytes_consumed_)
+        return fail(code, chunk, token_start_ - bytes_consumed_);
+
+    // the token started in an earlier chunk, its bytes from there are buffered
+    std::string source = token_.substr(0, bytes_consumed_ - token_start_);
+    source.append(chunk.substr(0, bencode_error::CONTEXT_SIZE));
+    bencode_error error = bencode_error::at(code, source, 0);
+    error.offset = token_start_;
+    return std::unexpected(error);
+}
+
+
+std::size_t bit_torrent::bencode_push_parser::consume_string_payload(std::string_view chunk) {
+    // whole payload is in this chunk, no need to copy it
+    if (string_remains_ == string_size_ && chunk.size() >= string_remains_) {
+        std::size_t consumed = string_remains_;
+        string_remains_ = 0;
+        emit_string(chunk.substr(0, consumed));
+        return consumed;
+    }
+
+    std::size_t consumed = std::min(chunk.size(), string_remains_);
+    if (!expects_key() && visitor_.accepts_string_parts()) {
+        string_remains_ -= consumed;
+        stopped_ = !visitor_.on_string_part(chunk.substr(0, consumed), string_size_, string_remains_ == 0);
+        if (string_remains_ == 0)
+            value_completed();
+        return consumed;
+    }
+
+    token_.append(chunk.substr(0, consumed));
+    string_remains_ -= consumed;
+    if (string_remains_ == 0) {
+        emit_string(token_);
+        token_.clear();
+    }
+
+    return consumed;
+}
+
+
+void bit_torrent::bencode_push_parser::emit_string(std::string_view value) {
+    if (expects_key()) {
+        containers_.back() = container_state::CONTAINER_DICT_VALUE;
+        state_ = parser_state::STATE_VALUE;
+        stopped_ = !visitor_.on_dictionary_key(value);
+        return;
+    }
+
+    stopped_ = !visitor_.on_string(value);
+    value_completed();
+}
+
+
+void bit_torrent::bencode_push_parser::value_completed() {
+    if (containers_.empty()) {
+        state_ = parser_state::STATE_DONE;
+        return;
+    }
+
+    if (containers_.back() == container_state::CONTAINER_DICT_VALUE)
+        containers_.back() = container_state::CONTAINER_DICT_KEY;
+
+    state_ = parser_state::STATE_VALUE;
+}
+
+
+bool bit_torrent::bencode_push_parser::expects_key() const {
+    return !containers_.empty() && containers_.back() == container_state::CONTAINER_DICT_KEY;
+}
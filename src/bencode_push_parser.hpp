@@ -0,0 +1,86 @@
+#ifndef BENCODE_PUSH_PARSER_HPP
+#define BENCODE_PUSH_PARSER_HPP
+
+#include <expected>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bencode_error.hpp"
+#include "bencode_limits.hpp"
+#include "bencode_visitor.hpp"
+
+namespace bit_torrent {
+
+/*
+    Incremental parser for bencode arriving in arbitrary chunks. The state is
+    kept between feed() calls and every value is reported to the visitor as
+    soon as it is complete. Byte strings that fit into one chunk are passed
+    without copying, strings split between chunks are buffered, unless the
+    visitor accepts string values in parts. Errors carry absolute offsets into
+    the whole input, ERROR_UNEXPECTED_END is only reported by finish(), so a
+    truncated input is told apart from a malformed one.
+*/
+class bencode_push_parser {
+    enum class parser_state : int {
+        STATE_VALUE,
+        STATE_INTEGER,
+        STATE_STRING_LENGTH,
+        STATE_STRING_PAYLOAD,
+        STATE_DONE
+    };
+
+    enum class container_state : int {
+        CONTAINER_LIST,
+        CONTAINER_DICT_KEY,
+        CONTAINER_DICT_VALUE
+    };
+
+    bencode_visitor &visitor_;
+    bencode_limits limits_;
+    std::size_t bytes_consumed_ = 0;
+    std::size_t elements_ = 0;
+    parser_state state_ = parser_state::STATE_VALUE;
+    std::vector<container_state> containers_;
+    std::string token_; // integer, string length digits or split string payload
+    std::size_t token_start_ = 0;
+    std::size_t string_size_ = 0;
+    std::size_t string_remains_ = 0;
+    bool stopped_ = false;
+
+    std::expected<std::size_t, bencode_error> consume_value_start(std::string_view chunk);
+    std::expected<std::size_t, bencode_error> consume_integer(std::string_view chunk);
+    std::expected<std::size_t, bencode_error> consume_string_length(std::string_view chunk);
+    std::size_t consume_string_payload(std::string_view chunk);
+
+    // chunk starts at bytes_consumed_
+    std::unexpected<bencode_error> fail(bencode_errc code, std::string_view chunk, std::size_t idx) const;
+    // integer or string length token starting at token_start_
+    std::unexpected<bencode_error> fail_token(bencode_errc code, std::string_view chunk) const;
+
+    void emit_string(std::string_view value);
+    void value_completed();
+    bool expects_key() const;
+
+public:
+    explicit bencode_push_parser(bencode_visitor &visitor, bencode_limits limits = {});
+
+    // returns the number of consumed bytes, which is less than chunk.size()
+    // only when the top-level value is complete or the visitor stopped
+    std::expected<std::size_t, bencode_error> try_feed(std::string_view chunk);
+    std::size_t feed(std::string_view chunk);
+
+    // ERROR_UNEXPECTED_END if the input ended before a complete top-level value
+    std::expected<void, bencode_error> try_finish() const;
+    void finish() const;
+
+    // a complete top-level value was parsed
+    bool done() const { return state_ == parser_state::STATE_DONE; }
+    bool stopped() const { return stopped_; }
+
+    void reset();
+};
+
+}
+
+#endif
@@ -0,0 +1,122 @@
+#include <stdexcept>
+#include <string>
+
+#include "bencode_query.hpp"
+#include "bencode_scan.hpp"
+
+namespace {
+
+void check_scan(bit_torrent::scan_status status) {
+    switch (status) {
+    case bit_torrent::scan_status::SCAN_OK:
+        return;
+
+    case bit_torrent::scan_status::SCAN_TRUNCATED:
+        throw std::runtime_error("bencode_query: unexpected end of input");
+
+    case bit_torrent::scan_status::SCAN_OUT_OF_RANGE:
+        throw std::runtime_error("bencode_query: number is out of range");
+
+    default:
+        throw std::runtime_error("bencode_query: invalid bencode format");
+    }
+}
+
+
+std::size_t value_length(std::string_view encoded) {
+    std::size_t length;
+    check_scan(bit_torrent::scan_value(encoded, length));
+    return length;
+}
+
+
+// moves encoded to the child value named by segment, false if there is no such child
+bool descend(std::string_view &encoded, std::string_view segment) {
+    if (encoded.empty())
+        return false;
+
+    if (encoded.front() == 'd') {
+        std::size_t position = 1;
+        while (position < encoded.size() && encoded[position] != 'e') {
+            std::string_view key;
+            std::size_t key_length;
+            check_scan(bit_torrent::scan_string(encoded.substr(position), key, key_length));
+            position += key_length;
+
+            if (key == segment) {
+                encoded.remove_prefix(position);
+                return true;
+            }
+            position += value_length(encoded.substr(position));
+        }
+        return false;
+    }
+
+    if (encoded.front() == 'l') {
+        std::uint64_t index;
+        std::size_t digit_count = bit_torrent::count_digits(segment.data(), segment.data()+segment.size());
+        if (digit_count == 0 || digit_count != segment.size() || 
+            !bit_torrent::decode_digits(segment.data(), digit_count, index))
+            return false;
+
+        std::size_t position = 1;
+        for (; index != 0 && position < encoded.size() && encoded[position] != 'e'; --index)
+            position += value_length(encoded.substr(position));
+
+        if (position >= encoded.size() || encoded[position] == 'e')
+            return false;
+
+        encoded.remove_prefix(position);
+        return true;
+    }
+
+    return false;
+}
+
+
+std::string_view query_required(std::string_view encoded, std::string_view path) {
+    std::optional<std::string_view> result = bit_torrent::bencode_query(encoded, path);
+    if (!result)
+        throw std::runtime_error("bencode_query: value not found: " + std::string{path});
+
+    return *result;
+}
+
+}
+
+
+std::optional<std::string_view> bit_torrent::bencode_query(std::string_view encoded, std::string_view path) {
+    while (!path.empty()) {
+        std::size_t separator_idx = path.find('/');
+        if (!descend(encoded, path.substr(0, separator_idx)))
+            return std::nullopt;
+
+        path.remove_prefix(separator_idx == std::string_view::npos ? path.size() : separator_idx+1);
+    }
+
+    return encoded.substr(0, value_length(encoded));
+}
+
+
+std::int64_t bit_torrent::bencode_query_integer(std::string_view encoded, std::string_view path) {
+    std::string_view value = query_required(encoded, path);
+    if (value.front() != 'i')
+        throw std::runtime_error("bencode_query: value is not an integer: " + std::string{path});
+
+    std::int64_t result;
+    std::size_t length;
+    check_scan(scan_integer(value, result, length));
+    return result;
+}
+
+
+std::string_view bit_torrent::bencode_query_string(std::string_view encoded, std::string_view path) {
+    std::string_view value = query_required(encoded, path);
+    if (value.front() == 'i' || value.front() == 'l' || value.front() == 'd')
+        throw std::runtime_error("bencode_query: value is not a string: " + std::string{path});
+
+    std::string_view result;
+    std::size_t length;
+    check_scan(scan_string(value, result, length));
+    return result;
+}
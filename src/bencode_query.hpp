@@ -0,0 +1,26 @@
+#ifndef BENCODE_QUERY_HPP
+#define BENCODE_QUERY_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace bit_torrent {
+
+/*
+    Lazy lookups over encoded bencode. The path is a '/' separated list of
+    dictionary keys and list indices, e.g. "info/piece length" or
+    "info/files/0/length". Values that are not on the path are skipped by
+    their length prefixes and never decoded.
+*/
+
+// exact encoded bytes of the value at path, std::nullopt if there is no such value
+std::optional<std::string_view> bencode_query(std::string_view encoded, std::string_view path);
+
+// decoded value at path, throws if it is missing or has another type
+std::int64_t bencode_query_integer(std::string_view encoded, std::string_view path);
+std::string_view bencode_query_string(std::string_view encoded, std::string_view path);
+
+}
+
+#endif
@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "bencode_scan.hpp"
+
+namespace {
+
+// longest digit run that always fits into uint64_t
+const std::size_t SAFE_DIGITS = 19;
+
+
+std::uint64_t decode_eight_digits(const char *digits) {
+    if constexpr (std::endian::native == std::endian::little) {
+        // SWAR: combine adjacent digits pairwise, 8 -> 4 -> 2 -> 1
+        std::uint64_t value;
+        std::memcpy(&value, digits, sizeof(value));
+        value = ((value & 0x0F0F0F0F0F0F0F0F) * 2561) >> 8;
+        value = ((value & 0x00FF00FF00FF00FF) * 6553601) >> 16;
+        return ((value & 0x0000FFFF0000FFFF) * 42949672960001) >> 32;
+    }
+
+    std::uint64_t value = 0;
+    for (std::size_t i = 0; i < 8; ++i)
+        value = value*10 + (digits[i] - '0');
+    return value;
+}
+
+}
+
+
+std::size_t bit_torrent::count_digits(const char *begin, const char *end) {
+    const char *current = begin;
+
+#if defined(__SSE2__)
+    const __m128i below_zero = _mm_set1_epi8('0' - 1);
+    const __m128i above_nine = _mm_set1_epi8('9' + 1);
+    while (end - current >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(current));
+        __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(chunk, below_zero), _mm_cmplt_epi8(chunk, above_nine));
+        unsigned mask = _mm_movemask_epi8(is_digit);
+        if (mask != 0xFFFF)
+            return current - begin + std::countr_one(mask);
+        current += 16;
+    }
+#endif
+
+    while (current != end && *current >= '0' && *current <= '9')
+        ++current;
+
+    return current - begin;
+}
+
+
+bool bit_torrent::decode_digits(const char *digits, std::size_t count, std::uint64_t &result) {
+    std::size_t safe_count = std::min(count, SAFE_DIGITS);
+    std::uint64_t value = 0;
+    std::size_t i = 0;
+    for (; i + 8 <= safe_count; i += 8)
+        value = value*100000000 + decode_eight_digits(digits+i);
+    for (; i < safe_count; ++i)
+        value = value*10 + (digits[i] - '0');
+
+    for (; i < count; ++i) {
+        unsigned digit = digits[i] - '0';
+        if (value > (UINT64_MAX - digit) / 10)
+            return false;
+        value = value*10 + digit;
+    }
+
+    result = value;
+    return true;
+}
+
+
+bit_torrent::scan_status bit_torrent::scan_integer(std::string_view encoded, std::int64_t &value, std::size_t &length) {
+    if (encoded.empty() || encoded.front() != 'i')
+        return encoded.empty() ? scan_status::SCAN_TRUNCATED : scan_status::SCAN_INVALID;
+
+    bool negative = encoded.size() > 1 && encoded[1] == '-';
+    std::size_t digits_idx = negative ? 2 : 1; // skipping 'i' and sign
+    std::size_t digit_count = count_digits(encoded.data()+std::min(digits_idx, encoded.size()), encoded.data()+encoded.size());
+    std::size_t end_idx = digits_idx+digit_count;
+    if (end_idx >= encoded.size())
+        return scan_status::SCAN_TRUNCATED;
+    if (digit_count == 0 || encoded[end_idx] != 'e')
+        return scan_status::SCAN_INVALID;
+
+    std::uint64_t magnitude;
+    std::uint64_t limit = negative ? std::uint64_t{1} << 63 : (std::uint64_t{1} << 63) - 1;
+    if (!decode_digits(encoded.data()+digits_idx, digit_count, magnitude) || magnitude > limit)
+        return scan_status::SCAN_OUT_OF_RANGE;
+
+    value = static_cast<std::int64_t>(negative ? ~magnitude+1 : magnitude);
+    length = end_idx+1; // with 'e'
+    return scan_status::SCAN_OK;
+}
+
+
+bit_torrent::scan_status bit_torrent::scan_string(std::string_view encoded, std::string_view &payload, std::size_t &length) {
+    std::size_t colon_idx = count_digits(encoded.data(), encoded.data()+encoded.size());
+    if (colon_idx == encoded.size())
+        return scan_status::SCAN_TRUNCATED;
+    if (colon_idx == 0 || encoded[colon_idx] != ':')
+        return scan_status::SCAN_INVALID;
+
+    std::uint64_t payload_size;
+    if (!decode_digits(encoded.data(), colon_idx, payload_size))
+        return scan_status::SCAN_OUT_OF_RANGE;
+
+    if (encoded.size()-colon_idx-1 < payload_size)
+        return scan_status::SCAN_TRUNCATED;
+
+    payload = encoded.substr(colon_idx+1, payload_size);
+    length = colon_idx+1+payload_size;
+    return scan_status::SCAN_OK;
+}
+
+
+bit_torrent::scan_status bit_torrent::scan_value(std::string_view encoded, std::size_t &length) {
+    std::size_t position = 0;
+    std::size_t depth = 0;
+    do {
+        if (position >= encoded.size())
+            return scan_status::SCAN_TRUNCATED;
+
+        std::string_view rest = encoded.substr(position);
+        std::size_t token_length = 1;
+        scan_status status = scan_status::SCAN_OK;
+        switch (rest.front()) {
+        case 'i': {
+            std::int64_t value;
+            status = scan_integer(rest, value, token_length);
+            break;
+        }
+
+        case 'l':
+        case 'd':
+            ++depth;
+            break;
+
+        case 'e':
+            if (depth == 0)
+                return scan_status::SCAN_INVALID;
+            --depth;
+            break;
+
+        default: {
+            std::string_view payload;
+            status = scan_string(rest, payload, token_length);
+            break;
+        }
+        }
+
+        if (status != scan_status::SCAN_OK)
+            return status;
+        position += token_length;
+    } while (depth != 0);
+
+    length = position;
+    return scan_status::SCAN_OK;
+}
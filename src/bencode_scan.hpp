@@ -0,0 +1,35 @@
+#ifndef BENCODE_SCAN_HPP
+#define BENCODE_SCAN_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace bit_torrent {
+
+enum class scan_status : int {
+    SCAN_OK,
+    SCAN_INVALID,      // malformed token
+    SCAN_OUT_OF_RANGE, // number doesn't fit its type
+    SCAN_TRUNCATED     // input ends inside the token
+};
+
+// number of leading ASCII digits in [begin, end)
+std::size_t count_digits(const char *begin, const char *end);
+
+// decodes count ASCII digits without allocating, returns false on uint64_t overflow
+bool decode_digits(const char *digits, std::size_t count, std::uint64_t &result);
+
+// "i<number>e" at the front of encoded, length receives the encoded size
+scan_status scan_integer(std::string_view encoded, std::int64_t &value, std::size_t &length);
+
+// "<size>:<payload>" at the front of encoded, payload points into encoded
+scan_status scan_string(std::string_view encoded, std::string_view &payload, std::size_t &length);
+
+// encoded size of the whole value at the front of encoded, nothing is decoded
+// and containers are walked without recursion
+scan_status scan_value(std::string_view encoded, std::size_t &length);
+
+}
+
+#endif
@@ -0,0 +1,70 @@
+#include "bencode_scan.hpp"
+#include "bencode_schema.hpp"
+
+namespace {
+
+void check_scan(bit_torrent::scan_status status, const char *what) {
+    switch (status) {
+    case bit_torrent::scan_status::SCAN_OK:
+        return;
+
+    case bit_torrent::scan_status::SCAN_TRUNCATED:
+        throw std::runtime_error(std::string{"bencode_schema: unexpected end of input in "} + what);
+
+    case bit_torrent::scan_status::SCAN_OUT_OF_RANGE:
+        throw std::runtime_error(std::string{"bencode_schema: number is out of range in "} + what);
+
+    default:
+        throw std::runtime_error(std::string{"bencode_schema: invalid "} + what);
+    }
+}
+
+}
+
+
+bit_torrent::bencode_reader::bencode_reader(std::string_view source) : source_(source), remains_(source) {}
+
+
+void bit_torrent::bencode_reader::expect(char ch) {
+    if (!consume_if(ch))
+        throw std::runtime_error(std::string{"bencode_schema: expected '"} + ch + "' at offset " + std::to_string(offset()));
+}
+
+
+bool bit_torrent::bencode_reader::consume_if(char ch) {
+    if (remains_.empty())
+        throw std::runtime_error("bencode_schema: unexpected end of input");
+
+    if (remains_.front() != ch)
+        return false;
+
+    remains_.remove_prefix(1);
+    return true;
+}
+
+
+std::int64_t bit_torrent::bencode_reader::read_integer() {
+    std::int64_t result;
+    std::size_t length;
+    check_scan(scan_integer(remains_, result, length), "integer");
+    remains_.remove_prefix(length);
+    return result;
+}
+
+
+std::string_view bit_torrent::bencode_reader::read_string() {
+    std::string_view result;
+    std::size_t length;
+    check_scan(scan_string(remains_, result, length), "string");
+    remains_.remove_prefix(length);
+    return result;
+}
+
+
+std::string_view bit_torrent::bencode_reader::read_raw() {
+    std::size_t length;
+    check_scan(scan_value(remains_, length), "value");
+    std::string_view result = remains_.substr(0, length);
+    remains_.remove_prefix(length);
+    return result;
+}
@@ -0,0 +1,278 @@
+#ifndef BENCODE_SCHEMA_HPP
+#define BENCODE_SCHEMA_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "byte_view.hpp"
+
+namespace bit_torrent {
+
+/*
+    Compile-time binding of bencode dictionaries to C++ structs. A struct is
+    made decodable by specializing bencode_schema_of:
+
+        template <>
+        struct bencode_schema_of<peer> {
+            using type = bencode_schema<
+                bencode_field<"ip", &peer::ip>,
+                bencode_field<"port", &peer::port>>;
+        };
+
+    Supported member types are integers, std::string_view and byte_view (both
+    point into the source), std::string, std::vector, std::optional (the key may be missing),
+    bencode_raw, bencode_with_raw and other structs with a schema. Keys are
+    matched through a perfect hash computed at compile time, unknown keys are
+    skipped without decoding.
+*/
+
+template <std::size_t N>
+struct fixed_string {
+    char value[N] {};
+
+    constexpr fixed_string(const char (&str)[N]) { std::copy_n(str, N, value); }
+    constexpr std::string_view view() const { return {value, N-1}; }
+};
+
+
+template <fixed_string Key, auto Member>
+struct bencode_field {
+    static constexpr std::string_view key = Key.view();
+    static constexpr auto member = Member;
+};
+
+
+template <typename... FieldsT>
+struct bencode_schema {};
+
+
+template <typename T>
+struct bencode_schema_of;
+
+
+// exact encoded bytes of a value
+struct bencode_raw {
+    std::string_view encoded;
+};
+
+
+// decoded value together with its exact encoded bytes
+template <typename T>
+struct bencode_with_raw {
+    T value;
+    std::string_view encoded;
+};
+
+
+// cursor over encoded bencode used by the schema decoders
+class bencode_reader {
+    std::string_view source_;
+    std::string_view remains_;
+
+public:
+    explicit bencode_reader(std::string_view source);
+
+    std::string_view source() const { return source_; }
+    std::size_t offset() const { return remains_.data() - source_.data(); }
+
+    void expect(char ch);
+    bool consume_if(char ch);
+
+    std::int64_t read_integer();
+    std::string_view read_string();
+    // skips a value of any type, returns its encoded bytes
+    std::string_view read_raw();
+};
+
+
+namespace detail {
+
+template <typename T> struct is_optional : std::false_type {};
+template <typename T> struct is_optional<std::optional<T>> : std::true_type {};
+
+template <typename T> struct is_vector : std::false_type {};
+template <typename T> struct is_vector<std::vector<T>> : std::true_type {};
+
+template <typename T> struct is_with_raw : std::false_type {};
+template <typename T> struct is_with_raw<bencode_with_raw<T>> : std::true_type {};
+
+template <typename T>
+concept has_schema = requires { typename bencode_schema_of<T>::type; };
+
+template <typename T>
+inline constexpr bool always_false = false;
+
+
+template <typename ClassT, typename MemberT>
+MemberT member_type_helper(MemberT ClassT::*);
+
+template <typename FieldT>
+using field_member_t = decltype(member_type_helper(FieldT::member));
+
+
+constexpr std::uint32_t key_hash(std::string_view key, std::uint32_t seed) {
+    // FNV-1a with a seed mixed into the offset basis
+    std::uint32_t hash = 2166136261u ^ seed;
+    for (char ch : key) {
+        hash ^= static_cast<unsigned char>(ch);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+
+template <typename T>
+void decode(bencode_reader &reader, T &out);
+
+
+template <typename ObjectT, typename SchemaT>
+struct schema_table;
+
+template <typename ObjectT, typename... FieldsT>
+struct schema_table<ObjectT, bencode_schema<FieldsT...>> {
+    static constexpr std::size_t FIELD_COUNT = sizeof...(FieldsT);
+    static constexpr std::size_t MAX_SLOTS = 256;
+    static_assert(FIELD_COUNT <= 64, "bencode_schema: at most 64 fields are supported");
+
+    static constexpr std::array<std::string_view, FIELD_COUNT> keys {FieldsT::key...};
+
+    struct hash_layout {
+        std::uint32_t seed;
+        std::size_t mask;
+        std::array<std::uint8_t, MAX_SLOTS> slots; // field index + 1, 0 is an empty slot
+    };
+
+    // smallest power-of-two table and a seed with no collisions between the keys
+    static constexpr hash_layout find_layout() {
+        for (std::size_t i = 0; i < FIELD_COUNT; ++i)
+            for (std::size_t j = i+1; j < FIELD_COUNT; ++j)
+                if (keys[i] == keys[j])
+                    throw std::logic_error("bencode_schema: duplicate key");
+
+        for (std::size_t size = std::bit_ceil(std::max<std::size_t>(FIELD_COUNT, 1)); size <= MAX_SLOTS; size *= 2) {
+            for (std::uint32_t seed = 0; seed < 1024; ++seed) {
+                hash_layout result {seed, size-1, {}};
+                bool collision = false;
+                for (std::size_t i = 0; i < FIELD_COUNT && !collision; ++i) {
+                    std::uint8_t &slot = result.slots[key_hash(keys[i], seed) & (size-1)];
+                    collision = slot != 0;
+                    slot = static_cast<std::uint8_t>(i+1);
+                }
+                if (!collision)
+                    return result;
+            }
+        }
+
+        throw std::logic_error("bencode_schema: no perfect hash for the keys");
+    }
+
+    static constexpr hash_layout layout = find_layout();
+
+    static constexpr std::uint64_t required_mask = [] {
+        std::uint64_t result = 0;
+        std::size_t index = 0;
+        ((result |= (is_optional<field_member_t<FieldsT>>::value ? 0 : std::uint64_t{1} << index), ++index), ...);
+        return result;
+    }();
+
+    using decoder = void (*)(bencode_reader &, ObjectT &);
+
+    template <std::size_t I>
+    static void decode_field(bencode_reader &reader, ObjectT &object) {
+        using field = std::tuple_element_t<I, std::tuple<FieldsT...>>;
+        decode(reader, object.*field::member);
+    }
+
+    template <std::size_t... I>
+    static constexpr std::array<decoder, FIELD_COUNT> make_decoders(std::index_sequence<I...>) {
+        return {&decode_field<I>...};
+    }
+
+    static constexpr std::array<decoder, FIELD_COUNT> decoders = make_decoders(std::index_sequence_for<FieldsT...> {});
+};
+
+
+template <has_schema T>
+void decode_object(bencode_reader &reader, T &out) {
+    using table = schema_table<T, typename bencode_schema_of<T>::type>;
+
+    reader.expect('d');
+    std::uint64_t seen = 0;
+    while (!reader.consume_if('e')) {
+        std::string_view key = reader.read_string();
+        std::size_t slot = table::layout.slots[key_hash(key, table::layout.seed) & table::layout.mask];
+        if (slot == 0 || table::keys[slot-1] != key) {
+            reader.read_raw(); // not in the schema
+            continue;
+        }
+
+        table::decoders[slot-1](reader, out);
+        seen |= std::uint64_t{1} << (slot-1);
+    }
+
+    if ((seen & table::required_mask) != table::required_mask) {
+        std::uint64_t missing = table::required_mask & ~seen;
+        throw std::runtime_error("bencode_schema: required key is missing: " +
+            std::string {table::keys[std::countr_zero(missing)]});
+    }
+}
+
+
+template <typename T>
+void decode(bencode_reader &reader, T &out) {
+    if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool>) {
+        std::int64_t value = reader.read_integer();
+        if (!std::in_range<T>(value))
+            throw std::runtime_error("bencode_schema: integer is out of range: " + std::to_string(value));
+        out = static_cast<T>(value);
+    } else if constexpr (std::is_same_v<T, std::string_view>) {
+        out = reader.read_string();
+    } else if constexpr (std::is_same_v<T, byte_view>) {
+        out = byte_view {reader.read_string()};
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        out = std::string {reader.read_string()};
+    } else if constexpr (std::is_same_v<T, bencode_raw>) {
+        out.encoded = reader.read_raw();
+    } else if constexpr (is_optional<T>::value) {
+        decode(reader, out.emplace());
+    } else if constexpr (is_vector<T>::value) {
+        reader.expect('l');
+        out.clear();
+        while (!reader.consume_if('e'))
+            decode(reader, out.emplace_back());
+    } else if constexpr (is_with_raw<T>::value) {
+        std::size_t begin = reader.offset();
+        decode(reader, out.value);
+        out.encoded = reader.source().substr(begin, reader.offset()-begin);
+    } else if constexpr (has_schema<T>) {
+        decode_object(reader, out);
+    } else {
+        static_assert(always_false<T>, "bencode_schema: type has no bencode representation");
+    }
+}
+
+}
+
+
+// decodes encoded straight into T, string views in the result point into encoded
+template <typename T>
+T bencode_decode(std::string_view encoded) {
+    bencode_reader reader {encoded};
+    T result {};
+    detail::decode(reader, result);
+    return result;
+}
+
+}
+
+#endif
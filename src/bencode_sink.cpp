@@ -0,0 +1,9 @@
+#include <stdexcept>
+
+#include "bencode_sink.hpp"
+
+
+void bit_torrent::streambuf_sink::write(const char *data, std::size_t size) {
+    if (target_.sputn(data, static_cast<std::streamsize>(size)) != static_cast<std::streamsize>(size))
+        throw std::runtime_error("streambuf_sink: short write");
+}
@@ -0,0 +1,54 @@
+#ifndef BENCODE_SINK_HPP
+#define BENCODE_SINK_HPP
+
+#include <streambuf>
+#include <string>
+
+#include "sha1.hpp"
+
+namespace bit_torrent {
+
+// destination of streamed bencode output
+class bencode_sink {
+public:
+    virtual ~bencode_sink() = default;
+
+    virtual void write(const char *data, std::size_t size) = 0;
+};
+
+
+// appends to a growing string
+class string_sink final : public bencode_sink {
+    std::string &target_;
+
+public:
+    explicit string_sink(std::string &target) : target_(target) {}
+
+    void write(const char *data, std::size_t size) override { target_.append(data, size); }
+};
+
+
+// writes through a stream buffer, e.g. a file or streamx::sun_iostreambuf over a descriptor
+class streambuf_sink final : public bencode_sink {
+    std::streambuf &target_;
+
+public:
+    explicit streambuf_sink(std::streambuf &target) : target_(target) {}
+
+    void write(const char *data, std::size_t size) override;
+};
+
+
+// feeds the bytes into a hash, e.g. to compute an info hash without the encoded dictionary
+class sha1_sink final : public bencode_sink {
+    SHA1 &hasher_;
+
+public:
+    explicit sha1_sink(SHA1 &hasher) : hasher_(hasher) {}
+
+    void write(const char *data, std::size_t size) override { hasher_.update(data, size); }
+};
+
+}
+
+#endif
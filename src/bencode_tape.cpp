@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+#include <string>
+
+#include "bencode_tape.hpp"
+
+
+bit_torrent::bencode_tape::node bit_torrent::bencode_tape::root() const {
+    if (entries_.empty())
+        throw std::runtime_error("bencode_tape: empty tape has no root");
+
+    return node {this, 0};
+}
+
+
+void bit_torrent::bencode_tape::index_keys() {
+    keys_begin_.assign(entries_.size(), UNINDEXED);
+    keys_.clear();
+    for (std::size_t i = 0; i < entries_.size(); ++i) {
+        if (type_of(i) != entry_type::TYPE_DICT)
+            continue;
+
+        std::size_t begin = keys_.size();
+        bool sorted = true;
+        for (std::size_t key = i+1; key != entries_[i].next; key = entries_[entries_[key].next].next) {
+            sorted = sorted && (keys_.size() == begin || payload(keys_.back()) < payload(key));
+            keys_.push_back(key);
+        }
+
+        if (sorted)
+            keys_begin_[i] = begin;
+        else
+            keys_.resize(begin); // found by scanning
+    }
+}
+
+
+std::string_view bit_torrent::bencode_tape::node::as_string() const {
+    if (!is_string())
+        throw std::runtime_error("bencode_tape: node is not a string");
+
+    return tape_->payload(index_);
+}
+
+
+std::int64_t bit_torrent::bencode_tape::node::as_integer() const {
+    if (!is_integer())
+        throw std::runtime_error("bencode_tape: node is not an integer");
+
+    // validated by the parser, without the leading 'i' and the trailing 'e'
+    std::string_view digits = raw().substr(1);
+    digits.remove_suffix(1);
+    std::int64_t result = 0;
+    std::from_chars(digits.data(), digits.data()+digits.size(), result);
+    return result;
+}
+
+
+std::string_view bit_torrent::bencode_tape::node::raw() const {
+    const entry &e = get();
+    return tape_->source_.substr(e.begin, e.end - e.begin);
+}
+
+
+std::size_t bit_torrent::bencode_tape::node::size() const {
+    if (!is_list() && !is_dictionary())
+        throw std::runtime_error("bencode_tape: node is not a container");
+
+    return get().value;
+}
+
+
+bit_torrent::bencode_tape::iterator bit_torrent::bencode_tape::node::begin() const {
+    if (!is_list() && !is_dictionary())
+        throw std::runtime_error("bencode_tape: node is not a container");
+
+    return iterator {tape_, index_+1};
+}
+
+
+bit_torrent::bencode_tape::iterator bit_torrent::bencode_tape::node::end() const {
+    return iterator {tape_, get().next};
+}
+
+
+std::optional<bit_torrent::bencode_tape::node> bit_torrent::bencode_tape::node::find(std::string_view key) const {
+    if (!is_dictionary())
+        throw std::runtime_error("bencode_tape: node is not a dictionary");
+
+    if (!tape_->keys_begin_.empty() && tape_->keys_begin_[index_] != UNINDEXED)
+        return find_indexed(key);
+
+    for (iterator iter = begin(), iend = end(); iter != iend; ++iter) {
+        node current_key = *iter;
+        node current_value = *++iter;
+        if (current_key.as_string() == key)
+            return current_value;
+    }
+
+    return std::nullopt;
+}
+
+
+std::optional<bit_torrent::bencode_tape::node> bit_torrent::bencode_tape::node::find_indexed(std::string_view key) const {
+    auto keys_begin = tape_->keys_.begin() + tape_->keys_begin_[index_];
+    auto keys_end = keys_begin + get().value;
+    auto found = std::lower_bound(keys_begin, keys_end, key, [this](std::size_t index, std::string_view value) {
+        return tape_->payload(index) < value;
+    });
+    if (found == keys_end || tape_->payload(*found) != key)
+        return std::nullopt;
+
+    return node {tape_, tape_->entries_[*found].next};
+}
+
+
+std::optional<bit_torrent::bencode_tape::node> bit_torrent::bencode_tape::node::query(std::string_view path) const {
+    node current = *this;
+    while (!path.empty()) {
+        std::size_t separator_idx = path.find('/');
+        std::string_view segment = path.substr(0, separator_idx);
+        path.remove_prefix(separator_idx == std::string_view::npos ? path.size() : separator_idx+1);
+
+        if (current.is_dictionary()) {
+            std::optional<node> child = current.find(segment);
+            if (!child)
+                return std::nullopt;
+            current = *child;
+            continue;
+        }
+
+        std::size_t index;
+        auto [ptr, ec] = std::from_chars(segment.data(), segment.data()+segment.size(), index);
+        if (!current.is_list() || ec != std::errc{} || ptr != segment.data()+segment.size() || index >= current.size())
+            return std::nullopt;
+
+        iterator iter = current.begin();
+        for (; index != 0; --index)
+            ++iter;
+        current = *iter;
+    }
+
+    return current;
+}
+
+
+bit_torrent::bencode_tape::node bit_torrent::bencode_tape::node::at(std::string_view key) const {
+    std::optional<node> result = find(key);
+    if (!result)
+        throw std::runtime_error("bencode_tape: key not found: " + std::string{key});
+
+    return *result;
+}
@@ -0,0 +1,134 @@
+#ifndef BENCODE_TAPE_HPP
+#define BENCODE_TAPE_HPP
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "byte_view.hpp"
+
+namespace bit_torrent {
+
+/*
+    Flat index of a bencoded document. Every value is one entry in pre-order,
+    containers know where their subtree ends, and byte strings are views into
+    the source buffer, so the source must outlive the tape. Entries hold 32-bit
+    offsets, the value type is the first encoded byte and integers are decoded
+    from the source when asked for, which keeps an entry at 16 bytes.
+*/
+class bencode_tape {
+public:
+    enum class entry_type : std::uint8_t {
+        TYPE_STRING,
+        TYPE_INT,
+        TYPE_LIST,
+        TYPE_DICT
+    };
+
+    struct entry {
+        std::uint32_t begin; // first byte of the encoded value
+        std::uint32_t end;   // one past the last byte of the encoded value
+        std::uint32_t next;  // index of the entry following this value's subtree
+        std::uint32_t value; // string payload offset or container element count, unused for integers
+    };
+
+    // larger sources are rejected with ERROR_SIZE_LIMIT, parse_document() has no such bound
+    static constexpr std::size_t MAX_SOURCE_SIZE = std::numeric_limits<std::uint32_t>::max();
+
+    class node;
+    class iterator;
+
+    bencode_tape() = default;
+
+    node root() const;
+    std::string_view source() const { return source_; }
+    const std::vector<entry> &entries() const { return entries_; }
+
+    // builds the per-document key index: afterwards find(), at() and query() binary search
+    // dictionaries with sorted keys, so a query costs O(depth * log(width)) instead of
+    // O(depth * width); dictionaries with unsorted keys are still scanned
+    void index_keys();
+
+private:
+    friend class bencode_parser;
+
+    static constexpr std::size_t UNINDEXED = static_cast<std::size_t>(-1);
+
+    std::string_view source_;
+    std::vector<entry> entries_;
+    std::vector<std::size_t> keys_begin_; // per entry, where the dictionary's keys start in keys_
+    std::vector<std::size_t> keys_; // entry indices of dictionary keys in key order
+
+    entry_type type_of(std::size_t index) const {
+        switch (source_[entries_[index].begin]) {
+        case 'i': return entry_type::TYPE_INT;
+        case 'l': return entry_type::TYPE_LIST;
+        case 'd': return entry_type::TYPE_DICT;
+        default:  return entry_type::TYPE_STRING;
+        }
+    }
+
+    std::string_view payload(std::size_t index) const {
+        return source_.substr(entries_[index].value, entries_[index].end - entries_[index].value);
+    }
+};
+
+
+class bencode_tape::node {
+    const bencode_tape *tape_;
+    std::size_t index_;
+
+    const entry &get() const { return tape_->entries_[index_]; }
+    std::optional<node> find_indexed(std::string_view key) const;
+
+public:
+    node(const bencode_tape *tape, std::size_t index) : tape_(tape), index_(index) {}
+
+    entry_type type() const { return tape_->type_of(index_); }
+    bool is_string() const { return type() == entry_type::TYPE_STRING; }
+    bool is_integer() const { return type() == entry_type::TYPE_INT; }
+    bool is_list() const { return type() == entry_type::TYPE_LIST; }
+    bool is_dictionary() const { return type() == entry_type::TYPE_DICT; }
+
+    // payload of a byte string, points into the source buffer
+    std::string_view as_string() const;
+    // the same payload for binary data, never treated as text
+    byte_view as_bytes() const { return byte_view {as_string()}; }
+    std::int64_t as_integer() const;
+
+    // exact encoded bytes of this value, as they appear in the source
+    std::string_view raw() const;
+
+    // number of list elements or dictionary pairs
+    std::size_t size() const;
+
+    // iterates list elements, or alternating keys and values of a dictionary
+    iterator begin() const;
+    iterator end() const;
+
+    std::optional<node> find(std::string_view key) const;
+    // '/' separated dictionary keys and list indices, subtrees off the path are skipped in O(1),
+    // dictionary keys are searched linearly unless the tape was indexed with index_keys()
+    std::optional<node> query(std::string_view path) const;
+    node at(std::string_view key) const;
+    node operator[](std::string_view key) const { return at(key); }
+};
+
+
+class bencode_tape::iterator {
+    const bencode_tape *tape_;
+    std::size_t index_;
+
+public:
+    iterator(const bencode_tape *tape, std::size_t index) : tape_(tape), index_(index) {}
+
+    node operator*() const { return node {tape_, index_}; }
+    iterator &operator++() { index_ = tape_->entries_[index_].next; return *this; }
+    bool operator==(const iterator &other) const { return index_ == other.index_; }
+};
+
+}
+
+#endif
@@ -0,0 +1,520 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+#include "bencode_parser.hpp"
+#include "bencode_push_parser.hpp"
+#include "bencode_transcoder.hpp"
+
+namespace {
+
+const std::size_t OUTPUT_BUFFER_SIZE = 1 << 16;
+const std::size_t INPUT_CHUNK_SIZE = 1 << 16;
+// long strings are encoded a slice at a time so the output buffer is flushed in between,
+// a multiple of 3 keeps base64 groups whole
+const std::size_t STRING_SLICE_SIZE = 3 << 14;
+
+
+bool is_valid_utf8(std::string_view value) {
+    const unsigned char *current = reinterpret_cast<const unsigned char*>(value.data());
+    const unsigned char *end = current + value.size();
+    while (current != end) {
+        // ASCII fast path, 8 bytes at a time
+        if (end - current >= 8) {
+            std::uint64_t block;
+            std::memcpy(&block, current, sizeof(block));
+            if ((block & 0x8080808080808080) == 0) {
+                current += 8;
+                continue;
+            }
+        }
+
+        unsigned char lead = *current;
+        if (lead < 0x80) {
+            ++current;
+            continue;
+        }
+
+        std::size_t length;
+        std::uint32_t code_point;
+        if ((lead & 0xE0) == 0xC0) {
+            length = 2;
+            code_point = lead & 0x1F;
+        } else if ((lead & 0xF0) == 0xE0) {
+            length = 3;
+            code_point = lead & 0x0F;
+        } else if ((lead & 0xF8) == 0xF0) {
+            length = 4;
+            code_point = lead & 0x07;
+        } else {
+            return false;
+        }
+
+        if (static_cast<std::size_t>(end - current) < length)
+            return false;
+
+        for (std::size_t i = 1; i < length; ++i) {
+            if ((current[i] & 0xC0) != 0x80)
+                return false;
+            code_point = (code_point << 6) | (current[i] & 0x3F);
+        }
+
+        static const std::uint32_t MIN_CODE_POINT[] = {0, 0, 0x80, 0x800, 0x10000};
+        if (code_point < MIN_CODE_POINT[length] || code_point > 0x10FFFF || 
+            (code_point >= 0xD800 && code_point <= 0xDFFF))
+            return false;
+
+        current += length;
+    }
+
+    return true;
+}
+
+
+// bytes in the UTF-8 sequence started by lead, 0 if lead can't start one
+std::size_t sequence_length(unsigned char lead) {
+    if (lead < 0x80)
+        return 1;
+    if ((lead & 0xE0) == 0xC0)
+        return 2;
+    if ((lead & 0xF0) == 0xE0)
+        return 3;
+    if ((lead & 0xF8) == 0xF0)
+        return 4;
+    return 0;
+}
+
+
+// bytes at the end of value that start a code point without finishing it
+std::size_t incomplete_tail(std::string_view value) {
+    for (std::size_t length = 1; length <= std::min<std::size_t>(3, value.size()); ++length) {
+        unsigned char ch = value[value.size() - length];
+        if ((ch & 0xC0) != 0x80)
+            return sequence_length(ch) > length ? length : 0;
+    }
+    return 0;
+}
+
+
+void append_hex(std::string &output, std::string_view value) {
+    static const char DIGITS[] = "0123456789abcdef";
+    for (unsigned char ch : value) {
+        output.push_back(DIGITS[ch >> 4]);
+        output.push_back(DIGITS[ch & 0xF]);
+    }
+}
+
+
+void append_base64(std::string &output, std::string_view value) {
+    static const char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    const unsigned char *data = reinterpret_cast<const unsigned char*>(value.data());
+    std::size_t i = 0;
+    for (; i + 3 <= value.size(); i += 3) {
+        std::uint32_t group = (data[i] << 16) | (data[i+1] << 8) | data[i+2];
+        output.push_back(ALPHABET[(group >> 18) & 0x3F]);
+        output.push_back(ALPHABET[(group >> 12) & 0x3F]);
+        output.push_back(ALPHABET[(group >> 6) & 0x3F]);
+        output.push_back(ALPHABET[group & 0x3F]);
+    }
+
+    if (std::size_t remains = value.size() - i; remains != 0) {
+        std::uint32_t group = (data[i] << 16) | (remains == 2 ? data[i+1] << 8 : 0);
+        output.push_back(ALPHABET[(group >> 18) & 0x3F]);
+        output.push_back(ALPHABET[(group >> 12) & 0x3F]);
+        output.push_back(remains == 2 ? ALPHABET[(group >> 6) & 0x3F] : '=');
+        output.push_back('=');
+    }
+}
+
+
+// same escaping as nlohmann::json::dump()
+void append_escaped(std::string &output, std::string_view value) {
+    static const char DIGITS[] = "0123456789abcdef";
+    for (char ch : value) {
+        switch (ch) {
+        case '"':  output.append("\\\""); break;
+        case '\\': output.append("\\\\"); break;
+        case '\b': output.append("\\b"); break;
+        case '\f': output.append("\\f"); break;
+        case '\n': output.append("\\n"); break;
+        case '\r': output.append("\\r"); break;
+        case '\t': output.append("\\t"); break;
+        default:
+            if (static_cast<unsigned char>(ch) < 0x20) {
+                output.append("\\u00");
+                output.push_back(DIGITS[(ch >> 4) & 0xF]);
+                output.push_back(DIGITS[ch & 0xF]);
+            } else {
+                output.push_back(ch);
+            }
+        }
+    }
+}
+
+
+
+// stops the parsing at the first dictionary key that is out of order or repeated
+class key_order_check final : public bit_torrent::bencode_visitor {
+    bit_torrent::bencode_key_order order_;
+
+public:
+    bool on_dictionary_begin() override { order_.open(); return true; }
+    bool on_dictionary_key(std::string_view key) override { return order_.next(key); }
+    bool on_dictionary_end() override { order_.close(); return true; }
+};
+
+
+// validates the rest of a string the writer holds back by reading ahead, so it doesn't have
+// to collect the whole string; input that can't seek back, like a pipe, is left alone
+void look_ahead(std::istream &input, bit_torrent::bencode_json_writer &writer, std::string &scratch) {
+    std::istream::pos_type position = input.tellg();
+    if (position == std::istream::pos_type(-1))
+        return;
+
+    bit_torrent::utf8_validator validator = writer.pending_validator();
+    std::size_t remains = writer.pending_string_remains();
+    while (remains != 0 && !validator.failed()) {
+        input.read(scratch.data(), std::min(remains, scratch.size()));
+        std::size_t got = static_cast<std::size_t>(input.gcount());
+        if (got == 0)
+            break; // truncated, the parser reports it
+        validator.update({scratch.data(), got});
+        remains -= got;
+    }
+
+    input.clear();
+    input.seekg(position);
+    writer.resolve_string(remains == 0 && validator.valid());
+}
+
+
+// writes keys sorted with the last duplicate winning, as a nlohmann::json object would;
+// the parser's depth limit bounds the recursion
+void write_sorted(const bit_torrent::bencode_value &value, bit_torrent::bencode_json_writer &writer) {
+    if (value.is_integer()) {
+        writer.on_integer(value.as_integer());
+    } else if (value.is_string()) {
+        writer.on_string(value.as_string());
+    } else if (value.is_list()) {
+        writer.on_list_begin();
+        for (const bit_torrent::bencode_value &element : value.as_list())
+            write_sorted(element, writer);
+        writer.on_list_end();
+    } else {
+        using pair_type = bit_torrent::bencode_value::dictionary_type::value_type;
+        std::vector<const pair_type*> pairs;
+        pairs.reserve(value.as_dictionary().size());
+        for (const pair_type &pair : value.as_dictionary())
+            pairs.push_back(&pair);
+        std::stable_sort(pairs.begin(), pairs.end(), [](const pair_type *a, const pair_type *b) { 
+            return a->first < b->first; 
+        });
+
+        writer.on_dictionary_begin();
+        for (std::size_t i = 0; i < pairs.size(); ++i) {
+            if (i+1 < pairs.size() && pairs[i+1]->first == pairs[i]->first)
+                continue;
+            writer.on_dictionary_key(pairs[i]->first);
+            write_sorted(pairs[i]->second, writer);
+        }
+        writer.on_dictionary_end();
+    }
+}
+
+}
+
+
+void bit_torrent::utf8_validator::update(std::string_view part) {
+    if (!valid_)
+        return;
+
+    if (partial_size_ != 0) {
+        std::size_t length = sequence_length(partial_[0]);
+        std::size_t taken = std::min(length - partial_size_, part.size());
+        std::memcpy(partial_ + partial_size_, part.data(), taken);
+        partial_size_ += taken;
+        part.remove_prefix(taken);
+        if (partial_size_ != length)
+            return;
+
+        valid_ = is_valid_utf8({partial_, length});
+        partial_size_ = 0;
+        if (!valid_)
+            return;
+    }
+
+    std::size_t tail = incomplete_tail(part);
+    valid_ = is_valid_utf8(part.substr(0, part.size() - tail));
+    std::memcpy(partial_, part.data() + part.size() - tail, tail);
+    partial_size_ = tail;
+}
+
+
+void bit_torrent::bencode_key_order::close() {
+    keys_.resize(open_.back().offset);
+    open_.pop_back();
+}
+
+
+bool bit_torrent::bencode_key_order::next(std::string_view key) {
+    open_dictionary &current = open_.back();
+    if (current.has_key && key <= std::string_view {keys_}.substr(current.offset))
+        return false;
+
+    keys_.resize(current.offset);
+    keys_.append(key);
+    current.has_key = true;
+    return true;
+}
+
+
+bit_torrent::bencode_json_writer::bencode_json_writer(std::ostream &output, binary_format format) : 
+    output_(output), format_(format) {
+    buffer_.reserve(OUTPUT_BUFFER_SIZE);
+}
+
+
+bit_torrent::bencode_json_writer::~bencode_json_writer() {
+    flush();
+}
+
+
+void bit_torrent::bencode_json_writer::separate() {
+    if (after_key_) {
+        after_key_ = false;
+        return;
+    }
+
+    if (first_in_container_.empty())
+        return;
+
+    if (!first_in_container_.back())
+        buffer_.push_back(',');
+    first_in_container_.back() = false;
+}
+
+
+void bit_torrent::bencode_json_writer::write_string(std::string_view value) {
+    buffer_.push_back('"');
+    if (is_valid_utf8(value)) {
+        for (std::size_t offset = 0; offset < value.size(); offset += STRING_SLICE_SIZE) {
+            append_escaped(buffer_, value.substr(offset, STRING_SLICE_SIZE));
+            flush_if_full();
+        }
+    } else {
+        write_binary_part(value);
+        append_base64(buffer_, base64_carry_);
+        base64_carry_.clear();
+    }
+    buffer_.push_back('"');
+    flush_if_full();
+}
+
+
+// next part of a string arriving in parts, once it's known how the string is rendered
+void bit_torrent::bencode_json_writer::write_part(std::string_view part) {
+    if (part_state_ == part_state::PART_BINARY) {
+        write_binary_part(part);
+        return;
+    }
+
+    for (std::size_t offset = 0; offset < part.size(); offset += STRING_SLICE_SIZE) {
+        append_escaped(buffer_, part.substr(offset, STRING_SLICE_SIZE));
+        flush_if_full();
+    }
+}
+
+
+// base64 groups that span parts are completed through base64_carry_
+void bit_torrent::bencode_json_writer::write_binary_part(std::string_view part) {
+    if (format_ == binary_format::BINARY_HEX) {
+        for (std::size_t offset = 0; offset < part.size(); offset += STRING_SLICE_SIZE) {
+            append_hex(buffer_, part.substr(offset, STRING_SLICE_SIZE));
+            flush_if_full();
+        }
+        return;
+    }
+
+    if (!base64_carry_.empty()) {
+        std::size_t taken = std::min(3 - base64_carry_.size(), part.size());
+        base64_carry_.append(part.substr(0, taken));
+        part.remove_prefix(taken);
+        if (base64_carry_.size() != 3)
+            return;
+        append_base64(buffer_, base64_carry_);
+        base64_carry_.clear();
+    }
+
+    std::size_t whole = part.size() / 3 * 3;
+    for (std::size_t offset = 0; offset < whole; offset += STRING_SLICE_SIZE) {
+        append_base64(buffer_, part.substr(offset, std::min(STRING_SLICE_SIZE, whole - offset)));
+        flush_if_full();
+    }
+    base64_carry_.assign(part.substr(whole));
+}
+
+
+void bit_torrent::bencode_json_writer::flush_if_full() {
+    if (buffer_.size() >= OUTPUT_BUFFER_SIZE)
+        flush();
+}
+
+
+void bit_torrent::bencode_json_writer::flush() {
+    output_.write(buffer_.data(), buffer_.size());
+    buffer_.clear();
+}
+
+
+bool bit_torrent::bencode_json_writer::on_integer(std::int64_t value) {
+    separate();
+    std::array<char, 24> digits;
+    auto [ptr, ec] = std::to_chars(digits.begin(), digits.end(), value);
+    buffer_.append(digits.data(), ptr);
+    flush_if_full();
+    return true;
+}
+
+
+bool bit_torrent::bencode_json_writer::on_string(std::string_view value) {
+    separate();
+    write_string(value);
+    return true;
+}
+
+
+bool bit_torrent::bencode_json_writer::on_string_part(std::string_view part, std::size_t total_size, bool last) {
+    if (part_state_ == part_state::PART_NONE) {
+        separate();
+        validator_ = {};
+        string_remains_ = total_size;
+        part_state_ = part_state::PART_PENDING;
+    }
+
+    string_remains_ -= part.size();
+    if (part_state_ == part_state::PART_PENDING) {
+        validator_.update(part);
+        pending_.append(part);
+        if (last)
+            resolve_string(validator_.valid());
+    } else {
+        write_part(part);
+    }
+
+    if (last) {
+        append_base64(buffer_, base64_carry_);
+        base64_carry_.clear();
+        buffer_.push_back('"');
+        part_state_ = part_state::PART_NONE;
+        flush_if_full();
+    }
+    return true;
+}
+
+
+void bit_torrent::bencode_json_writer::resolve_string(bool valid_utf8) {
+    part_state_ = valid_utf8 ? part_state::PART_TEXT : part_state::PART_BINARY;
+    buffer_.push_back('"');
+    write_part(pending_);
+    pending_.clear();
+}
+
+
+bool bit_torrent::bencode_json_writer::on_list_begin() {
+    separate();
+    buffer_.push_back('[');
+    first_in_container_.push_back(true);
+    return true;
+}
+
+
+bool bit_torrent::bencode_json_writer::on_list_end() {
+    buffer_.push_back(']');
+    first_in_container_.pop_back();
+    flush_if_full();
+    return true;
+}
+
+
+bool bit_torrent::bencode_json_writer::on_dictionary_begin() {
+    separate();
+    buffer_.push_back('{');
+    first_in_container_.push_back(true);
+    key_order_.open();
+    return true;
+}
+
+
+bool bit_torrent::bencode_json_writer::on_dictionary_key(std::string_view key) {
+    if (!key_order_.next(key))
+        throw std::runtime_error("bencode_json_writer: dictionary key is out of order or repeated");
+
+    separate();
+    write_string(key);
+    buffer_.push_back(':');
+    after_key_ = true;
+    return true;
+}
+
+
+bool bit_torrent::bencode_json_writer::on_dictionary_end() {
+    buffer_.push_back('}');
+    first_in_container_.pop_back();
+    key_order_.close();
+    flush_if_full();
+    return true;
+}
+
+
+void bit_torrent::bencode_json_writer::end_document() {
+    buffer_.push_back('\n');
+    flush_if_full();
+}
+
+
+void bit_torrent::bencode_to_json(std::string_view encoded, std::ostream &output, binary_format format) {
+    bencode_json_writer writer {output, format};
+    bencode_parser parser {};
+    key_order_check check {};
+    if (parser.parse(encoded, check))
+        parser.parse(encoded, writer);
+    else
+        write_sorted(parser.parse_document(encoded).root(), writer);
+    writer.end_document();
+}
+
+
+void bit_torrent::bencode_to_json(std::istream &input, std::ostream &output, binary_format format) {
+    bencode_json_writer writer {output, format};
+    bencode_push_parser parser {writer};
+    bool inside_value = false;
+
+    std::string chunk (INPUT_CHUNK_SIZE, '\0');
+    std::string scratch (INPUT_CHUNK_SIZE, '\0');
+    while (input.read(chunk.data(), chunk.size()) || input.gcount() != 0) {
+        std::string_view remains {chunk.data(), static_cast<std::size_t>(input.gcount())};
+        while (!remains.empty()) {
+            if (!inside_value) {
+                // values may be separated by whitespace, e.g. one per line
+                remains.remove_prefix(std::min(remains.find_first_not_of(" \t\r\n"), remains.size()));
+                if (remains.empty())
+                    break;
+            }
+
+            inside_value = true;
+            remains.remove_prefix(parser.feed(remains));
+            if (writer.string_pending())
+                look_ahead(input, writer, scratch);
+            if (parser.done()) {
+                writer.end_document();
+                parser.reset();
+                inside_value = false;
+            }
+        }
+    }
+
+    if (inside_value)
+        parser.finish();
+}
@@ -0,0 +1,129 @@
+#ifndef BENCODE_TRANSCODER_HPP
+#define BENCODE_TRANSCODER_HPP
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bencode_visitor.hpp"
+
+namespace bit_torrent {
+
+// how byte strings that are not valid UTF-8 are rendered as JSON strings
+enum class binary_format : int {
+    BINARY_HEX,
+    BINARY_BASE64
+};
+
+
+// checks UTF-8 that arrives in parts, a code point may be split between two of them
+class utf8_validator {
+    char partial_[4] = {}; // start of a code point cut off by the end of the last part
+    std::size_t partial_size_ = 0;
+    bool valid_ = true;
+
+public:
+    void update(std::string_view part);
+    // everything so far is valid and doesn't end inside a code point
+    bool valid() const { return valid_ && partial_size_ == 0; }
+    // an invalid sequence was seen, more parts can't make it valid
+    bool failed() const { return !valid_; }
+};
+
+
+// tracks the last key of every open dictionary to find keys that are out of order or repeated
+class bencode_key_order {
+    struct open_dictionary {
+        std::size_t offset; // where its last key starts in keys_
+        bool has_key;
+    };
+
+    std::string keys_;
+    std::vector<open_dictionary> open_;
+
+public:
+    void open() { open_.push_back({keys_.size(), false}); }
+    void close();
+    // false if key doesn't sort strictly after the previous key of the innermost dictionary
+    bool next(std::string_view key);
+};
+
+
+/*
+    Writes visitor events as compact JSON into a buffer that is flushed to
+    output in large blocks. Dictionaries are written in the order they
+    arrive, so their keys must be sorted and unique as bencode requires,
+    otherwise a runtime_error is thrown.
+
+    A byte string arriving in parts is held back until it is known whether
+    all of it is valid UTF-8, which decides between text and the binary
+    format. Readers that can look ahead validate its remaining bytes and call
+    resolve_string() early, otherwise it is held until its last part.
+*/
+class bencode_json_writer final : public bencode_visitor {
+    enum class part_state : int {
+        PART_NONE,    // no string is arriving in parts
+        PART_PENDING, // its parts are held in pending_
+        PART_TEXT,
+        PART_BINARY
+    };
+
+    std::ostream &output_;
+    binary_format format_;
+    std::string buffer_;
+    std::vector<char> first_in_container_;
+    bencode_key_order key_order_;
+    bool after_key_ = false;
+
+    // string value arriving in parts
+    part_state part_state_ = part_state::PART_NONE;
+    std::size_t string_remains_ = 0; // bytes of it not received yet
+    utf8_validator validator_;
+    std::string pending_;
+    std::string base64_carry_; // bytes of an incomplete base64 group
+
+    void separate();
+    void write_string(std::string_view value);
+    void write_part(std::string_view part);
+    void write_binary_part(std::string_view part);
+    void flush_if_full();
+
+public:
+    bencode_json_writer(std::ostream &output, binary_format format);
+    ~bencode_json_writer() override;
+
+    bool on_integer(std::int64_t value) override;
+    bool on_string(std::string_view value) override;
+    bool on_list_begin() override;
+    bool on_list_end() override;
+    bool on_dictionary_begin() override;
+    bool on_dictionary_key(std::string_view key) override;
+    bool on_dictionary_end() override;
+    bool accepts_string_parts() const override { return true; }
+    bool on_string_part(std::string_view part, std::size_t total_size, bool last) override;
+
+    bool string_pending() const { return part_state_ == part_state::PART_PENDING; }
+    std::size_t pending_string_remains() const { return string_remains_; }
+    // state after the parts received so far, to continue with the bytes read ahead
+    const utf8_validator &pending_validator() const { return validator_; }
+    void resolve_string(bool valid_utf8);
+
+    void end_document();
+    void flush();
+};
+
+
+// no tree is built when dictionary keys are sorted and unique, which a quick first pass checks;
+// otherwise keys are sorted and the last duplicate wins, like in a nlohmann::json object
+void bencode_to_json(std::string_view encoded, std::ostream &output, binary_format format = binary_format::BINARY_HEX);
+
+// reads input in chunks, every top-level value becomes one JSON line; values may be separated
+// by whitespace and dictionary keys must be sorted and unique; memory is constant for seekable
+// input, from a pipe a string longer than the input chunk is held whole to validate its UTF-8
+void bencode_to_json(std::istream &input, std::ostream &output, binary_format format = binary_format::BINARY_HEX);
+
+}
+
+#endif
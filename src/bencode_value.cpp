@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "bencode_value.hpp"
+
+namespace {
+
+// first chunk requested from upstream, enough for a typical single file torrent
+const std::size_t INITIAL_ARENA_SIZE = 4096;
+
+}
+
+
+bit_torrent::bencode_value::bencode_value(dictionary_type value) {
+    auto key_less = [](const auto &lhs, const auto &rhs) { return lhs.first < rhs.first; };
+    auto key_not_less = [](const auto &lhs, const auto &rhs) { return !(lhs.first < rhs.first); };
+    // canonical bencode has strictly increasing keys, so this is usually a single pass
+    if (std::adjacent_find(value.begin(), value.end(), key_not_less) != value.end()) {
+        std::stable_sort(value.begin(), value.end(), key_less);
+
+        // a repeated key keeps its last value, like the json mode and write_sorted()
+        auto kept = value.begin();
+        for (auto iter = value.begin(); iter != value.end(); ++iter) {
+            if (iter+1 != value.end() && (iter+1)->first == iter->first)
+                continue;
+            if (kept != iter)
+                *kept = std::move(*iter);
+            ++kept;
+        }
+        value.erase(kept, value.end());
+    }
+
+    data_ = std::move(value);
+}
+
+
+std::string_view bit_torrent::bencode_value::as_string() const {
+    if (!is_string())
+        throw std::runtime_error("bencode_value: value is not a string");
+
+    return std::get<std::string_view>(data_);
+}
+
+
+std::int64_t bit_torrent::bencode_value::as_integer() const {
+    if (!is_integer())
+        throw std::runtime_error("bencode_value: value is not an integer");
+
+    return std::get<std::int64_t>(data_);
+}
+
+
+const bit_torrent::bencode_value::list_type &bit_torrent::bencode_value::as_list() const {
+    if (!is_list())
+        throw std::runtime_error("bencode_value: value is not a list");
+
+    return std::get<list_type>(data_);
+}
+
+
+const bit_torrent::bencode_value::dictionary_type &bit_torrent::bencode_value::as_dictionary() const {
+    if (!is_dictionary())
+        throw std::runtime_error("bencode_value: value is not a dictionary");
+
+    return std::get<dictionary_type>(data_);
+}
+
+
+const bit_torrent::bencode_value *bit_torrent::bencode_value::find(std::string_view key) const {
+    const dictionary_type &dictionary = as_dictionary();
+    auto iter = std::lower_bound(dictionary.begin(), dictionary.end(), key, 
+        [](const auto &item, std::string_view key) { return item.first < key; });
+
+    if (iter == dictionary.end() || iter->first != key)
+        return nullptr;
+
+    return &iter->second;
+}
+
+
+const bit_torrent::bencode_value &bit_torrent::bencode_value::at(std::string_view key) const {
+    const bencode_value *result = find(key);
+    if (result == nullptr)
+        throw std::runtime_error("bencode_value: key not found: " + std::string{key});
+
+    return *result;
+}
+
+
+bit_torrent::bencode_document::bencode_document() : 
+    arena_(std::make_unique<std::pmr::monotonic_buffer_resource>(INITIAL_ARENA_SIZE)) {
+    set_root(bencode_value {});
+}
+
+
+void bit_torrent::bencode_document::set_root(bencode_value value) {
+    // the root lives in the arena too and is never destroyed, all of its memory is released with the arena
+    void *storage = arena_->allocate(sizeof(bencode_value), alignof(bencode_value));
+    root_ = new (storage) bencode_value {std::move(value)};
+}
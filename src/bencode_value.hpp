@@ -0,0 +1,84 @@
+#ifndef BENCODE_VALUE_HPP
+#define BENCODE_VALUE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "byte_view.hpp"
+
+namespace bit_torrent {
+
+/*
+    Native bencode value. Containers allocate from the memory resource they
+    were built with, byte strings are views into the source buffer.
+    Dictionaries are kept sorted by key, a repeated key keeps its last value.
+*/
+class bencode_value {
+public:
+    using list_type = std::pmr::vector<bencode_value>;
+    using dictionary_type = std::pmr::vector<std::pair<std::string_view, bencode_value>>;
+
+    enum class value_type : int {
+        TYPE_STRING,
+        TYPE_INT,
+        TYPE_LIST,
+        TYPE_DICT
+    };
+
+private:
+    // alternatives are in value_type order
+    std::variant<std::string_view, std::int64_t, list_type, dictionary_type> data_;
+
+public:
+    bencode_value() : data_(std::int64_t{0}) {}
+    explicit bencode_value(std::string_view value) : data_(value) {}
+    explicit bencode_value(std::int64_t value) : data_(value) {}
+    explicit bencode_value(list_type value) : data_(std::move(value)) {}
+    explicit bencode_value(dictionary_type value);
+
+    value_type type() const { return static_cast<value_type>(data_.index()); }
+    bool is_string() const { return type() == value_type::TYPE_STRING; }
+    bool is_integer() const { return type() == value_type::TYPE_INT; }
+    bool is_list() const { return type() == value_type::TYPE_LIST; }
+    bool is_dictionary() const { return type() == value_type::TYPE_DICT; }
+
+    std::string_view as_string() const;
+    // the same payload for binary data, never treated as text
+    byte_view as_bytes() const { return byte_view {as_string()}; }
+    std::int64_t as_integer() const;
+    const list_type &as_list() const;
+    const dictionary_type &as_dictionary() const;
+
+    // binary search in a dictionary, nullptr if there is no such key
+    const bencode_value *find(std::string_view key) const;
+    const bencode_value &at(std::string_view key) const;
+    const bencode_value &operator[](std::string_view key) const { return at(key); }
+};
+
+
+/*
+    Owns a monotonic arena with every node of a parsed document. Nodes are
+    never destroyed one by one, the whole arena is released at once.
+*/
+class bencode_document {
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> arena_;
+    bencode_value *root_ = nullptr;
+
+public:
+    bencode_document();
+
+    std::pmr::memory_resource *resource() const { return arena_.get(); }
+
+    const bencode_value &root() const { return *root_; }
+    // containers of value must be allocated from resource(), the root is never destroyed
+    void set_root(bencode_value value);
+};
+
+}
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef BENCODE_VISITOR_HPP
+#define BENCODE_VISITOR_HPP
+
+#include <cstdint>
+#include <string_view>
+
+namespace bit_torrent {
+
+/*
+    Receives bencode values as the parser walks the input, no tree is built.
+    String views are only valid during the call. Returning false from any
+    handler stops the parsing.
+*/
+class bencode_visitor {
+public:
+    virtual ~bencode_visitor() = default;
+
+    virtual bool on_integer(std::int64_t) { return true; }
+    virtual bool on_string(std::string_view) { return true; }
+
+    virtual bool on_list_begin() { return true; }
+    virtual bool on_list_end() { return true; }
+
+    // every key is followed by exactly one value
+    virtual bool on_dictionary_begin() { return true; }
+    virtual bool on_dictionary_key(std::string_view) { return true; }
+    virtual bool on_dictionary_end() { return true; }
+
+    // bencode_push_parser passes byte string values split between chunks in parts to
+    // visitors that accept them, instead of buffering them for on_string(); total_size
+    // is the size of the whole string and last marks its final part
+    virtual bool accepts_string_parts() const { return false; }
+    virtual bool on_string_part(std::string_view, std::size_t, bool) { return true; }
+};
+
+}
+
+#endif
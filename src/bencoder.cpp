@@ -1,80 +1,284 @@
-#include <sstream>
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
 
 #include "bencoder.hpp"
 
 using json = nlohmann::json;
 
-namespace {
+/*
+    Encoding into a string runs in two passes: the first one computes the
+    exact encoded size, the second one writes every token straight into a
+    single preallocated buffer, so no temporary string is created per node.
+    Encoding into a sink is a single pass through a small fixed block.
+*/
 
-std::string bencode_detected(const json &what);
+namespace {
 
+template <typename NumberT>
+std::size_t decimal_size(NumberT value) {
+    char digits[24];
+    return std::to_chars(digits, digits+sizeof(digits), value).ptr - digits;
+}
 
-std::string bencode_integer(const json &what) {
-    assert(what.is_number_integer());
 
-    std::stringstream result_stream {};
-    result_stream << 'i' << what.get<int64_t>() << 'e';
-    return result_stream.str();
+std::size_t string_size(std::size_t length) {
+    return decimal_size(length) + 1 + length; // <length>:<payload>
 }
 
 
-std::string bencode_list(const json &what) {
-    assert(what.is_array());
+// writes into a buffer of the exact encoded size
+class span_output {
+    char *out_;
 
-    std::stringstream result_stream {};
-    result_stream << 'l';
-    for (const json &i : what)
-        result_stream << bencode_detected(i);
-    result_stream << 'e';
-    return result_stream.str();
-}
+public:
+    explicit span_output(char *out) : out_(out) {}
 
+    char *position() const { return out_; }
 
-std::string bencode_string(const json &what) {
-    assert(what.is_string());
+    void put(char ch) { *out_++ = ch; }
 
-    std::stringstream result_stream {};
-    const json::string_t *str = what.get_ptr<const json::string_t*>();
-    result_stream << str->size() << ':' << *str;
-    return result_stream.str();
-}
+    template <typename NumberT>
+    void put_number(NumberT value) { out_ = std::to_chars(out_, out_+24, value).ptr; }
+
+    void put_bytes(const void *data, std::size_t size) {
+        std::memcpy(out_, data, size);
+        out_ += size;
+    }
+};
+
+
+// collects small tokens into a block before passing them to the sink, large payloads go straight through
+class sink_output {
+    static const std::size_t BLOCK_SIZE = 4096;
+
+    bit_torrent::bencode_sink &sink_;
+    std::array<char, BLOCK_SIZE> block_;
+    std::size_t size_ = 0;
+
+public:
+    explicit sink_output(bit_torrent::bencode_sink &sink) : sink_(sink) {}
+
+    void flush() {
+        if (size_ != 0)
+            sink_.write(block_.data(), size_);
+        size_ = 0;
+    }
+
+    void put(char ch) {
+        if (size_ == BLOCK_SIZE)
+            flush();
+        block_[size_++] = ch;
+    }
+
+    template <typename NumberT>
+    void put_number(NumberT value) {
+        if (BLOCK_SIZE - size_ < 24)
+            flush();
+        size_ = std::to_chars(block_.data()+size_, block_.data()+BLOCK_SIZE, value).ptr - block_.data();
+    }
+
+    void put_bytes(const void *data, std::size_t size) {
+        if (BLOCK_SIZE - size_ < size)
+            flush();
+        if (size >= BLOCK_SIZE) {
+            sink_.write(static_cast<const char*>(data), size);
+            return;
+        }
+        std::memcpy(block_.data()+size_, data, size);
+        size_ += size;
+    }
+};
 
 
-std::string bencode_dictionary(const json &what) {
-    assert(what.is_object());
+template <typename OutputT>
+void write_string(OutputT &out, const void *data, std::size_t size) {
+    out.put_number(size);
+    out.put(':');
+    out.put_bytes(data, size);
+}
+
 
-    std::stringstream result_stream {};
-    result_stream << 'd';
-    for (const auto &i : what.items())
-        result_stream << bencode_string(i.key()) << bencode_detected(i.value());
-    result_stream << 'e';
-    return result_stream.str();
+[[noreturn]] void unsupported_type(const json &what) {
+    throw std::runtime_error("can't detect bencode type: " + what.dump());
 }
 
 
-std::string bencode_detected(const json &what) {
+std::size_t encoded_size(const json &what) {
     switch (what.type()) {
     case json::value_t::string:
-        return bencode_string(what);
-    
+        return string_size(what.get_ref<const json::string_t&>().size());
+
+    case json::value_t::binary:
+        return string_size(what.get_binary().size());
+
+    case json::value_t::number_integer:
+        return decimal_size(what.get<std::int64_t>()) + 2; // i<number>e
+
+    case json::value_t::array: {
+        std::size_t result = 2; // l...e
+        for (const json &i : what)
+            result += encoded_size(i);
+        return result;
+    }
+
+    case json::value_t::object: {
+        std::size_t result = 2; // d...e
+        for (const auto &i : what.items())
+            result += string_size(i.key().size()) + encoded_size(i.value());
+        return result;
+    }
+
+    default:
+        unsupported_type(what);
+    }
+}
+
+
+template <typename OutputT>
+void encode_to(OutputT &out, const json &what) {
+    switch (what.type()) {
+    case json::value_t::string: {
+        const json::string_t &value = what.get_ref<const json::string_t&>();
+        write_string(out, value.data(), value.size());
+        return;
+    }
+
+    case json::value_t::binary: {
+        const json::binary_t &value = what.get_binary();
+        write_string(out, value.data(), value.size());
+        return;
+    }
+
     case json::value_t::number_integer:
-        return bencode_integer(what);
-    
+        out.put('i');
+        out.put_number(what.get<std::int64_t>());
+        out.put('e');
+        return;
+
     case json::value_t::array:
-        return bencode_list(what);
-    
+        out.put('l');
+        for (const json &i : what)
+            encode_to(out, i);
+        out.put('e');
+        return;
+
     case json::value_t::object:
-        return bencode_dictionary(what);
+        out.put('d');
+        for (const auto &i : what.items()) {
+            write_string(out, i.key().data(), i.key().size());
+            encode_to(out, i.value());
+        }
+        out.put('e');
+        return;
+
+    default:
+        unsupported_type(what);
     }
+}
 
-    throw std::runtime_error("can't detect bencode type: " + what.dump());
+
+std::size_t encoded_size(const bit_torrent::bencode_value &what) {
+    using value_type = bit_torrent::bencode_value::value_type;
+
+    switch (what.type()) {
+    case value_type::TYPE_STRING:
+        return string_size(what.as_string().size());
+
+    case value_type::TYPE_INT:
+        return decimal_size(what.as_integer()) + 2;
+
+    case value_type::TYPE_LIST: {
+        std::size_t result = 2;
+        for (const bit_torrent::bencode_value &i : what.as_list())
+            result += encoded_size(i);
+        return result;
+    }
+
+    case value_type::TYPE_DICT: {
+        std::size_t result = 2;
+        for (const auto &i : what.as_dictionary())
+            result += string_size(i.first.size()) + encoded_size(i.second);
+        return result;
+    }
+    }
+
+    return 0;
+}
+
+
+template <typename OutputT>
+void encode_to(OutputT &out, const bit_torrent::bencode_value &what) {
+    using value_type = bit_torrent::bencode_value::value_type;
+
+    switch (what.type()) {
+    case value_type::TYPE_STRING:
+        write_string(out, what.as_string().data(), what.as_string().size());
+        return;
+
+    case value_type::TYPE_INT:
+        out.put('i');
+        out.put_number(what.as_integer());
+        out.put('e');
+        return;
+
+    case value_type::TYPE_LIST:
+        out.put('l');
+        for (const bit_torrent::bencode_value &i : what.as_list())
+            encode_to(out, i);
+        out.put('e');
+        return;
+
+    case value_type::TYPE_DICT:
+        out.put('d');
+        for (const auto &i : what.as_dictionary()) {
+            write_string(out, i.first.data(), i.first.size());
+            encode_to(out, i.second);
+        }
+        out.put('e');
+        return;
+    }
 }
 
 
+template <typename ValueT>
+std::string encode(const ValueT &what) {
+    std::string result;
+    result.resize_and_overwrite(encoded_size(what), [&](char *buffer, std::size_t) {
+        span_output out {buffer};
+        encode_to(out, what);
+        return out.position() - buffer;
+    });
+    return result;
+}
+
+
+template <typename ValueT>
+void encode(const ValueT &what, bit_torrent::bencode_sink &sink) {
+    sink_output out {sink};
+    encode_to(out, what);
+    out.flush();
+}
+
 }
 
 
 std::string bit_torrent::bencode_json(const json &what) {
-    return bencode_detected(what);
+    return encode(what);
 }
 
+
+std::string bit_torrent::bencode_json(const bencode_value &what) {
+    return encode(what);
+}
+
+
+void bit_torrent::bencode_json(const json &what, bencode_sink &sink) {
+    encode(what, sink);
+}
+
+
+void bit_torrent::bencode_json(const bencode_value &what, bencode_sink &sink) {
+    encode(what, sink);
+}
@@ -4,10 +4,17 @@
 #include <string>
 
 #include "lib/nlohmann/json.hpp"
+#include "bencode_sink.hpp"
+#include "bencode_value.hpp"
 
 namespace bit_torrent {
 
 std::string bencode_json(const nlohmann::json& what);
+std::string bencode_json(const bencode_value& what);
+
+// streams the encoding into sink, the whole encoded value is never held in memory
+void bencode_json(const nlohmann::json& what, bencode_sink &sink);
+void bencode_json(const bencode_value& what, bencode_sink &sink);
 
 
 }
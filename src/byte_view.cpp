@@ -0,0 +1,32 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "byte_view.hpp"
+
+
+bit_torrent::byte_view bit_torrent::byte_view::substr(std::size_t offset, std::size_t count) const {
+    if (offset > size_)
+        throw std::out_of_range("byte_view: offset is out of range");
+
+    return byte_view {data_ + offset, std::min(count, size_ - offset)};
+}
+
+
+bit_torrent::byte_view bit_torrent::byte_view::chunk(std::size_t index, std::size_t chunk_size) const {
+    if (index >= chunk_count(chunk_size))
+        throw std::out_of_range("byte_view: chunk index is out of range: " + std::to_string(index));
+
+    return byte_view {data_ + index*chunk_size, chunk_size};
+}
+
+
+std::string bit_torrent::byte_view::to_hex() const {
+    static const char DIGITS[] = "0123456789abcdef";
+    std::string result (size_*2, '\0');
+    for (std::size_t i = 0; i < size_; ++i) {
+        result[i*2] = DIGITS[data_[i] >> 4];
+        result[i*2+1] = DIGITS[data_[i] & 0xF];
+    }
+
+    return result;
+}
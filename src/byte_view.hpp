@@ -0,0 +1,54 @@
+#ifndef BYTE_VIEW_HPP
+#define BYTE_VIEW_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace bit_torrent {
+
+/*
+    Non-owning view of a bencode byte string that holds binary data, such as
+    piece hashes or compact peers. Unlike std::string_view it is never treated
+    as text: the bytes are not UTF-8 validated or escaped unless as_chars() or
+    to_hex() is called explicitly.
+*/
+class byte_view {
+    const std::uint8_t *data_ = nullptr;
+    std::size_t size_ = 0;
+
+public:
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    constexpr byte_view() = default;
+    constexpr byte_view(const std::uint8_t *data, std::size_t size) : data_(data), size_(size) {}
+    explicit byte_view(std::string_view chars) : 
+        data_(reinterpret_cast<const std::uint8_t*>(chars.data())), size_(chars.size()) {}
+
+    const std::uint8_t *data() const { return data_; }
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    std::uint8_t operator[](std::size_t index) const { return data_[index]; }
+    const std::uint8_t *begin() const { return data_; }
+    const std::uint8_t *end() const { return data_ + size_; }
+
+    byte_view substr(std::size_t offset, std::size_t count = npos) const;
+
+    // number of whole chunk_size pieces, a shorter tail is not counted
+    std::size_t chunk_count(std::size_t chunk_size) const { return size_ / chunk_size; }
+    // index-th whole chunk_size piece, throws when it is past the last whole chunk
+    byte_view chunk(std::size_t index, std::size_t chunk_size) const;
+
+    std::string_view as_chars() const { return {reinterpret_cast<const char*>(data_), size_}; }
+    std::string to_hex() const;
+
+    bool operator==(const byte_view &other) const {
+        return size_ == other.size_ && (size_ == 0 || std::memcmp(data_, other.data_, size_) == 0);
+    }
+};
+
+}
+
+#endif
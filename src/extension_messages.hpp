@@ -0,0 +1,55 @@
+#ifndef EXTENSION_MESSAGES_HPP
+#define EXTENSION_MESSAGES_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#include "bencode_fixed.hpp"
+
+namespace bit_torrent {
+
+// message ids of the extensions we support, as advertised in the handshake "m" dictionary
+using extension_map = bencode_fixed_dict<
+    bencode_fixed_field<"ut_metadata", std::int64_t>>;
+
+
+// BEP 10 extension handshake
+using extension_handshake = bencode_fixed_dict<
+    bencode_fixed_field<"m", extension_map>,
+    bencode_fixed_field<"metadata_size", std::optional<std::int64_t>>,
+    bencode_fixed_field<"v", std::optional<std::string_view>>>;
+
+
+// BEP 9 metadata messages
+enum class ut_metadata_type : std::int64_t {
+    UT_METADATA_REQUEST = 0,
+    UT_METADATA_DATA = 1,
+    UT_METADATA_REJECT = 2
+};
+
+
+using ut_metadata_message = bencode_fixed_dict<
+    bencode_fixed_field<"msg_type", std::int64_t>,
+    bencode_fixed_field<"piece", std::int64_t>,
+    bencode_fixed_field<"total_size", std::optional<std::int64_t>>>;
+
+
+inline ut_metadata_message ut_metadata_request(std::int64_t piece) {
+    return {static_cast<std::int64_t>(ut_metadata_type::UT_METADATA_REQUEST), piece, std::nullopt};
+}
+
+
+// the piece payload itself follows the dictionary
+inline ut_metadata_message ut_metadata_data(std::int64_t piece, std::int64_t total_size) {
+    return {static_cast<std::int64_t>(ut_metadata_type::UT_METADATA_DATA), piece, total_size};
+}
+
+
+inline ut_metadata_message ut_metadata_reject(std::int64_t piece) {
+    return {static_cast<std::int64_t>(ut_metadata_type::UT_METADATA_REJECT), piece, std::nullopt};
+}
+
+}
+
+#endif
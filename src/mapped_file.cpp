@@ -0,0 +1,120 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include "mapped_file.hpp"
+
+namespace {
+
+std::runtime_error file_error(const std::string &what, const std::string &filename) {
+    return std::runtime_error("mapped_file: " + what + " " + filename + ": " + std::strerror(errno));
+}
+
+
+// closes the descriptor on every way out of the constructor, stdin is left open;
+// the error thrown on a failure is built before the guard closes, so errno is intact
+class descriptor_guard {
+    int fd_;
+
+public:
+    explicit descriptor_guard(int fd) : fd_(fd) {}
+    ~descriptor_guard() {
+        if (fd_ != STDIN_FILENO)
+            close(fd_);
+    }
+
+    descriptor_guard(const descriptor_guard &) = delete;
+    descriptor_guard &operator=(const descriptor_guard &) = delete;
+};
+
+}
+
+
+bit_torrent::mapped_file::mapped_file(const std::string &filename, access_pattern pattern) {
+    bool is_stdin = filename == "-";
+    int fd = is_stdin ? STDIN_FILENO : open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        throw file_error("unable to open file", filename);
+
+    descriptor_guard guard {fd}; // the mapping stays valid after close
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == -1)
+        throw file_error("unable to stat file", filename);
+
+    if (!S_ISREG(file_stat.st_mode)) {
+        read_all(fd, filename);
+        return;
+    }
+
+    size_ = file_stat.st_size;
+    if (size_ != 0) {
+        void *address = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED)
+            throw file_error("unable to map file", filename);
+
+        // hints only, failures are harmless
+        madvise(address, size_, pattern == access_pattern::ACCESS_SEQUENTIAL ? MADV_SEQUENTIAL : MADV_RANDOM);
+        if (pattern == access_pattern::ACCESS_SEQUENTIAL)
+            madvise(address, size_, MADV_WILLNEED);
+
+        data_ = static_cast<const char*>(address);
+        mapped_ = true;
+    }
+}
+
+
+bit_torrent::mapped_file::~mapped_file() {
+    release();
+}
+
+
+bit_torrent::mapped_file::mapped_file(mapped_file &&other) noexcept {
+    *this = std::move(other);
+}
+
+
+bit_torrent::mapped_file &bit_torrent::mapped_file::operator=(mapped_file &&other) noexcept {
+    if (this == &other)
+        return *this;
+
+    release();
+    fallback_ = std::move(other.fallback_);
+    mapped_ = std::exchange(other.mapped_, false);
+    size_ = std::exchange(other.size_, 0);
+    data_ = mapped_ ? std::exchange(other.data_, nullptr) : fallback_.data();
+    other.data_ = nullptr;
+    return *this;
+}
+
+
+void bit_torrent::mapped_file::read_all(int fd, const std::string &filename) {
+    char chunk[65536];
+    ssize_t bytes_read;
+    while ((bytes_read = read(fd, chunk, sizeof(chunk))) != 0) {
+        if (bytes_read == -1) {
+            if (errno == EINTR) continue;
+            throw file_error("unable to read file", filename);
+        }
+        fallback_.append(chunk, bytes_read);
+    }
+
+    data_ = fallback_.data();
+    size_ = fallback_.size();
+}
+
+
+void bit_torrent::mapped_file::release() {
+    if (mapped_)
+        munmap(const_cast<char*>(data_), size_);
+
+    data_ = nullptr;
+    size_ = 0;
+    mapped_ = false;
+    fallback_.clear();
+}
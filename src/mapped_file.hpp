@@ -0,0 +1,45 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <string>
+#include <string_view>
+
+namespace bit_torrent {
+
+/*
+    Read-only view of a whole file. Regular files are memory-mapped, pipes and
+    other unmappable files (and "-" for stdin) are read into memory instead.
+*/
+class mapped_file {
+public:
+    enum class access_pattern : int {
+        ACCESS_SEQUENTIAL,
+        ACCESS_RANDOM
+    };
+
+private:
+    const char *data_ = nullptr;
+    std::size_t size_ = 0;
+    bool mapped_ = false;
+    std::string fallback_;
+
+    void read_all(int fd, const std::string &filename);
+    void release();
+
+public:
+    explicit mapped_file(const std::string &filename, access_pattern pattern = access_pattern::ACCESS_SEQUENTIAL);
+    ~mapped_file();
+
+    mapped_file(mapped_file &&other) noexcept;
+    mapped_file &operator=(mapped_file &&other) noexcept;
+    mapped_file(const mapped_file &) = delete;
+    mapped_file &operator=(const mapped_file &) = delete;
+
+    std::string_view view() const { return {data_, size_}; }
+    std::size_t size() const { return size_; }
+    bool is_mapped() const { return mapped_; }
+};
+
+}
+
+#endif
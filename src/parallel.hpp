@@ -0,0 +1,154 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bit_torrent {
+
+// number of workers used when the caller doesn't ask for a specific count
+inline unsigned default_thread_count() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+
+/*
+    Fixed set of threads that run parallel_for jobs one after another, so
+    callers with many small jobs don't start new threads for each of them.
+    The calling thread works on every job too, a pool of size 1 has no
+    extra threads at all.
+*/
+class thread_pool {
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable finished_;
+    std::vector<std::jthread> workers_;
+
+    // current job, type-erased without allocating
+    void (*job_)(void *) = nullptr;
+    void *job_context_ = nullptr;
+    std::size_t generation_ = 0;
+    std::size_t running_ = 0;
+    bool stopping_ = false;
+
+    void work() {
+        std::size_t seen = 0;
+        std::unique_lock lock {mutex_};
+        while (true) {
+            wake_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+            if (stopping_)
+                return;
+
+            seen = generation_;
+            lock.unlock();
+            job_(job_context_);
+            lock.lock();
+            if (--running_ == 0)
+                finished_.notify_one();
+        }
+    }
+
+    template <typename JobT>
+    void run(JobT &job) {
+        {
+            std::lock_guard lock {mutex_};
+            job_ = [](void *context) { (*static_cast<JobT*>(context))(); };
+            job_context_ = &job;
+            running_ = workers_.size();
+            ++generation_;
+        }
+        wake_.notify_all();
+
+        job();
+        std::unique_lock lock {mutex_};
+        finished_.wait(lock, [this] { return running_ == 0; });
+    }
+
+public:
+    explicit thread_pool(unsigned threads = 0) {
+        std::size_t extra = (threads == 0 ? default_thread_count() : threads) - 1;
+        workers_.reserve(extra);
+        for (std::size_t i = 0; i < extra; ++i)
+            workers_.emplace_back([this] { work(); });
+    }
+
+    ~thread_pool() {
+        {
+            std::lock_guard lock {mutex_};
+            stopping_ = true;
+        }
+        wake_.notify_all();
+    }
+
+    thread_pool(const thread_pool &) = delete;
+    thread_pool &operator=(const thread_pool &) = delete;
+
+    // threads working on each job, the caller included
+    std::size_t size() const { return workers_.size() + 1; }
+
+    /*
+        Calls function(i) for every i in [0, count). Workers take indices
+        from a shared counter in chunks of grain, so faster workers simply
+        claim more work. The first exception thrown by function is rethrown
+        after all workers have stopped.
+    */
+    template <typename FunctionT>
+    void parallel_for(std::size_t count, FunctionT &&function, std::size_t grain = 1) {
+        if (count == 0)
+            return;
+
+        std::atomic<std::size_t> next {0};
+        std::atomic<bool> failed {false};
+        std::exception_ptr error;
+        std::mutex error_mutex;
+
+        auto worker = [&] {
+            while (!failed.load(std::memory_order_relaxed)) {
+                std::size_t begin = next.fetch_add(grain, std::memory_order_relaxed);
+                if (begin >= count)
+                    return;
+
+                try {
+                    for (std::size_t i = begin; i < std::min(begin+grain, count); ++i)
+                        function(i);
+                } catch (...) {
+                    std::lock_guard lock {error_mutex};
+                    if (!error)
+                        error = std::current_exception();
+                    failed = true;
+                }
+            }
+        };
+
+        if (workers_.empty() || count <= grain)
+            worker();
+        else
+            run(worker);
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+};
+
+
+// one-off parallel_for on a pool sized for count, see thread_pool::parallel_for
+template <typename FunctionT>
+void parallel_for(std::size_t count, FunctionT &&function, unsigned threads = 0, std::size_t grain = 1) {
+    if (count == 0)
+        return;
+
+    std::size_t worker_count = std::min<std::size_t>(threads == 0 ? default_thread_count() : threads,
+        (count + grain - 1) / grain);
+    thread_pool pool {static_cast<unsigned>(worker_count)};
+    pool.parallel_for(count, std::forward<FunctionT>(function), grain);
+}
+
+}
+
+#endif
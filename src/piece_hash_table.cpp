@@ -0,0 +1,38 @@
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "piece_hash_table.hpp"
+
+
+bit_torrent::piece_hash_table::piece_hash_table(byte_view pieces) {
+    if (pieces.size() % SHA1::DIGEST_SIZE != 0)
+        throw std::runtime_error("piece_hash_table: pieces length is not a multiple of " +
+            std::to_string(SHA1::DIGEST_SIZE) + ": " + std::to_string(pieces.size()));
+
+    data_.reset(new (std::align_val_t {ALIGNMENT}) std::uint8_t[pieces.size()]);
+    if (!pieces.empty())
+        std::memcpy(data_.get(), pieces.data(), pieces.size());
+    size_ = pieces.size() / SHA1::DIGEST_SIZE;
+}
+
+
+bool bit_torrent::piece_hash_table::matches(std::size_t index, const SHA1::digest_type &digest) const {
+    const std::uint8_t *expected = data() + index*SHA1::DIGEST_SIZE;
+#if defined(__SSE2__)
+    // first 16 bytes in one vector compare, the last 4 as a word
+    __m128i head = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(expected)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(digest.data())));
+    std::uint32_t expected_tail, digest_tail;
+    std::memcpy(&expected_tail, expected + 16, 4);
+    std::memcpy(&digest_tail, digest.data() + 16, 4);
+    return _mm_movemask_epi8(head) == 0xFFFF && expected_tail == digest_tail;
+#else
+    return std::memcmp(expected, digest.data(), SHA1::DIGEST_SIZE) == 0;
+#endif
+}
@@ -0,0 +1,54 @@
+#ifndef PIECE_HASH_TABLE_HPP
+#define PIECE_HASH_TABLE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <string>
+
+#include "byte_view.hpp"
+#include "sha1.hpp"
+
+namespace bit_torrent {
+
+/*
+    Owned copy of a torrent's "pieces": the 20-byte digests packed back to
+    back in one cache line aligned block, so digest i is at data() + 20*i and
+    500k pieces take 10 MB. Comparing against a computed digest is one
+    vector compare of the first 16 bytes and one of the last 4.
+*/
+class piece_hash_table {
+public:
+    static constexpr std::size_t ALIGNMENT = 64;
+
+private:
+    struct aligned_delete {
+        void operator()(std::uint8_t *data) const { ::operator delete[](data, std::align_val_t {ALIGNMENT}); }
+    };
+
+    std::unique_ptr<std::uint8_t[], aligned_delete> data_;
+    std::size_t size_ = 0;
+
+public:
+    piece_hash_table() = default;
+    // throws if pieces is not a whole number of digests
+    explicit piece_hash_table(byte_view pieces);
+
+    piece_hash_table(piece_hash_table &&) noexcept = default;
+    piece_hash_table &operator=(piece_hash_table &&) noexcept = default;
+
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const std::uint8_t *data() const { return data_.get(); }
+
+    // index-th digest, not bounds checked
+    byte_view operator[](std::size_t index) const { return {data() + index*SHA1::DIGEST_SIZE, SHA1::DIGEST_SIZE}; }
+    std::string hex(std::size_t index) const { return (*this)[index].to_hex(); }
+
+    // compares the index-th digest with a computed one, not bounds checked
+    bool matches(std::size_t index, const SHA1::digest_type &digest) const;
+};
+
+}
+
+#endif
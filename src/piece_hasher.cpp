@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <queue>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "parallel.hpp"
+#include "piece_hasher.hpp"
+
+namespace {
+
+// bytes read ahead per batch, and batches in flight between the reader and the hashers
+const std::size_t BATCH_BYTES = 1 << 24;
+const std::size_t BATCH_COUNT = 3;
+// batches grow past BATCH_BYTES to fill the SIMD lanes of every thread, up to this size
+const std::size_t MAX_BATCH_BYTES = 1 << 28;
+// every batch holds at least one whole piece, larger pieces aren't hashed
+const std::int64_t MAX_PIECE_LENGTH = std::int64_t {1} << 28;
+
+
+// reads all files as one continuous stream, the way pieces span them
+class concatenated_reader {
+    const std::vector<bit_torrent::piece_file> &files_;
+    std::int64_t piece_length_;
+    std::vector<bool> &readable_;
+    std::size_t current_ = 0;
+    std::int64_t file_offset_ = 0; // position in the current file
+    std::int64_t offset_ = 0;      // position in the whole stream
+    std::ifstream stream_;
+    bool failed_ = false; // the current file can't be opened or ended early
+    std::uint64_t bytes_read_ = 0;
+
+    void mark_unreadable(std::int64_t size) {
+        for (std::int64_t piece = offset_ / piece_length_; piece <= (offset_ + size - 1) / piece_length_; ++piece)
+            readable_[piece] = false;
+    }
+
+public:
+    concatenated_reader(const std::vector<bit_torrent::piece_file> &files, std::int64_t piece_length,
+        std::vector<bool> &readable) : files_(files), piece_length_(piece_length), readable_(readable) {}
+
+    // fills as much of [out, out+size) as the remaining data allows
+    std::size_t read(char *out, std::size_t size) {
+        std::size_t total = 0;
+        while (total < size && current_ < files_.size()) {
+            const bit_torrent::piece_file &file = files_[current_];
+            std::size_t wanted = static_cast<std::size_t>(std::min<std::int64_t>(size - total, file.length - file_offset_));
+            if (wanted != 0) {
+                if (!stream_.is_open() && !failed_) {
+                    stream_.open(file.path, std::ios::binary);
+                    failed_ = !stream_;
+                }
+
+                std::size_t got = 0;
+                if (!failed_) {
+                    stream_.read(out + total, static_cast<std::streamsize>(wanted));
+                    got = static_cast<std::size_t>(stream_.gcount());
+                    failed_ = got < wanted;
+                }
+                bytes_read_ += got;
+
+                offset_ += got;
+                if (got < wanted) {
+                    std::memset(out + total + got, 0, wanted - got);
+                    mark_unreadable(wanted - got);
+                    offset_ += wanted - got;
+                }
+                total += wanted;
+                file_offset_ += wanted;
+            }
+
+            if (file_offset_ == file.length) {
+                stream_.close();
+                stream_.clear();
+                failed_ = false;
+                file_offset_ = 0;
+                ++current_;
+            }
+        }
+
+        return total;
+    }
+
+    std::uint64_t bytes_read() const { return bytes_read_; }
+};
+
+
+struct batch {
+    std::vector<char> data;
+    std::size_t size = 0;
+    std::size_t first_piece = 0;
+};
+
+
+// handoff between the reader thread and the hashing loop, closed when no more batches come
+class batch_queue {
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::queue<batch> batches_;
+    bool closed_ = false;
+
+public:
+    void push(batch value) {
+        {
+            std::lock_guard lock {mutex_};
+            batches_.push(std::move(value));
+        }
+        ready_.notify_one();
+    }
+
+    std::optional<batch> pop() {
+        std::unique_lock lock {mutex_};
+        ready_.wait(lock, [this] { return !batches_.empty() || closed_; });
+        if (batches_.empty())
+            return std::nullopt;
+
+        batch result = std::move(batches_.front());
+        batches_.pop();
+        return result;
+    }
+
+    void close() {
+        {
+            std::lock_guard lock {mutex_};
+            closed_ = true;
+        }
+        ready_.notify_all();
+    }
+};
+
+}
+
+
+bit_torrent::piece_hashes bit_torrent::hash_pieces(const std::vector<piece_file> &files,
+        std::int64_t piece_length, unsigned threads) {
+    if (piece_length <= 0 || piece_length > MAX_PIECE_LENGTH)
+        throw std::runtime_error("hash_pieces: piece length must be positive and at most " +
+            std::to_string(MAX_PIECE_LENGTH) + ": " + std::to_string(piece_length));
+
+    std::int64_t total_length = 0;
+    for (const piece_file &file : files) {
+        if (file.length < 0)
+            throw std::runtime_error("hash_pieces: negative length of " + file.path.string());
+        if (file.length > std::numeric_limits<std::int64_t>::max() - total_length)
+            throw std::runtime_error("hash_pieces: total length overflows");
+        total_length += file.length;
+    }
+
+    bit_torrent::thread_pool hashers {threads};
+    std::size_t lanes = SHA1::multi_buffer_lanes();
+
+    std::size_t piece_count = static_cast<std::size_t>((total_length + piece_length - 1) / piece_length);
+    std::size_t batch_pieces = std::max({std::size_t {1}, BATCH_BYTES / piece_length,
+        std::min(hashers.size() * lanes, MAX_BATCH_BYTES / piece_length)});
+    // small inputs don't need whole batches
+    std::size_t batch_size = static_cast<std::size_t>(std::min<std::int64_t>(batch_pieces * piece_length, total_length));
+    piece_hashes result {std::vector<SHA1::digest_type> (piece_count), std::vector<bool> (piece_count, true)};
+    std::size_t lane_pieces = 0;
+
+    batch_queue full_batches;
+    batch_queue empty_batches;
+    try {
+        for (std::size_t i = 0; i < BATCH_COUNT; ++i)
+            empty_batches.push({std::vector<char> (batch_size), 0, 0});
+    } catch (const std::bad_alloc &) {
+        throw std::runtime_error("hash_pieces: can't buffer pieces of " + std::to_string(piece_length) + " bytes");
+    }
+
+    // only the reader writes result.readable until it is joined
+    std::exception_ptr reader_error;
+    std::jthread reader {[&] {
+        try {
+            concatenated_reader input {files, piece_length, result.readable};
+            for (std::size_t piece = 0; piece < piece_count; piece += batch_pieces) {
+                std::optional<batch> next = empty_batches.pop();
+                if (!next)
+                    break;
+
+                next->first_piece = piece;
+                next->size = input.read(next->data.data(), next->data.size());
+                full_batches.push(std::move(*next));
+            }
+            result.bytes_read = input.bytes_read();
+        } catch (...) {
+            reader_error = std::current_exception();
+        }
+        full_batches.close();
+    }};
+
+    try {
+        std::vector<std::span<const std::byte>> pieces;
+        while (std::optional<batch> current = full_batches.pop()) {
+            std::size_t count = (current->size + piece_length - 1) / piece_length;
+            pieces.clear();
+            for (std::size_t offset = 0; offset < current->size; offset += piece_length)
+                pieces.push_back(std::as_bytes(std::span {current->data.data() + offset,
+                    std::min<std::size_t>(piece_length, current->size - offset)}));
+
+            // whole lane groups while there are enough to keep every thread busy, single pieces otherwise
+            std::size_t group = count >= hashers.size() * lanes ? lanes : 1;
+            std::size_t tasks = (count + group - 1) / group;
+            if (group != 1)
+                lane_pieces += count / lanes * lanes;
+            result.workers = std::max(result.workers, std::min(tasks, hashers.size()));
+            hashers.parallel_for(tasks, [&](std::size_t task) {
+                std::size_t first = task * group;
+                std::vector<SHA1::digest_type> digests = SHA1::hash_many(
+                    std::span {pieces}.subspan(first, std::min(group, count - first)));
+                std::copy(digests.begin(), digests.end(), result.digests.begin() + current->first_piece + first);
+            });
+
+            empty_batches.push(std::move(*current));
+        }
+    } catch (...) {
+        empty_batches.close(); // stops the reader
+        throw;
+    }
+
+    reader.join();
+    if (reader_error)
+        std::rethrow_exception(reader_error);
+
+    result.engine = lane_pieces * 2 >= piece_count ? SHA1::multi_buffer_implementation() : SHA1::implementation();
+
+    return result;
+}
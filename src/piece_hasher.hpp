@@ -0,0 +1,41 @@
+#ifndef PIECE_HASHER_HPP
+#define PIECE_HASHER_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "sha1.hpp"
+
+namespace bit_torrent {
+
+struct piece_file {
+    std::filesystem::path path;
+    std::int64_t length; // bytes the file takes in the piece stream
+};
+
+
+struct piece_hashes {
+    std::vector<SHA1::digest_type> digests;
+    std::vector<bool> readable; // false for pieces covering a missing or truncated file
+    std::uint64_t bytes_read = 0; // bytes that came from the files, without the zero fill
+    std::size_t workers = 0;      // most threads a single batch was split between
+    const char *engine = SHA1::implementation(); // SHA1 engine most pieces went through
+};
+
+
+/*
+    Hashes files as one continuous stream cut into pieces, the way torrents
+    lay them out. Data is read sequentially by a read-ahead thread in batches
+    of pieces, while the previous batch is hashed on a pool of threads, so
+    reading and hashing overlap. A batch holds enough pieces to give every
+    thread a full group of SIMD lanes where memory allows, and is split per
+    piece when it can't fill them. Bytes of a file that can't be opened or
+    ends early read as zeros, so later files keep their offsets. Throws on
+    negative file lengths and on pieces too large to buffer in memory.
+*/
+piece_hashes hash_pieces(const std::vector<piece_file> &files, std::int64_t piece_length, unsigned threads = 0);
+
+}
+
+#endif
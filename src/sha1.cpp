@@ -1,3 +1,14 @@
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
 #include "sha1.hpp"
 
 namespace {
@@ -6,7 +17,7 @@ const std::size_t BLOCK_INTS = 16;  /* number of 32bit integers per SHA1 block *
 const std::size_t BLOCK_BYTES = BLOCK_INTS * 4;
 
 
-void reset(uint32_t digest[], std::string &buffer, uint64_t &transforms)
+void reset(uint32_t digest[], std::size_t &buffer_size, uint64_t &transforms)
 {
     /* SHA1 initialization constants */
     digest[0] = 0x67452301;
@@ -16,7 +27,7 @@ void reset(uint32_t digest[], std::string &buffer, uint64_t &transforms)
     digest[4] = 0xc3d2e1f0;
 
     /* Reset counters */
-    buffer = "";
+    buffer_size = 0;
     transforms = 0;
 }
 
@@ -80,7 +91,7 @@ void R4(uint32_t block[BLOCK_INTS], const uint32_t v, uint32_t &w, const uint32_
  * Hash a single 512-bit block. This is the core of the algorithm.
  */
 
-void transform(uint32_t digest[], uint32_t block[BLOCK_INTS], uint64_t &transforms)
+void transform(uint32_t digest[], uint32_t block[BLOCK_INTS])
 {
     /* Copy digest[] to working vars */
     uint32_t a = digest[0];
@@ -177,15 +188,12 @@ void transform(uint32_t digest[], uint32_t block[BLOCK_INTS], uint64_t &transfor
     digest[2] += c;
     digest[3] += d;
     digest[4] += e;
-
-    /* Count the number of transformations */
-    transforms++;
 }
 
 
-void buffer_to_block(const std::string &buffer, uint32_t block[BLOCK_INTS])
+void buffer_to_block(const char *buffer, uint32_t block[BLOCK_INTS])
 {
-    /* Convert the std::string (byte buffer) to a uint32_t array (MSB) */
+    /* Convert the byte buffer to a uint32_t array (MSB) */
     for (std::size_t i = 0; i < BLOCK_INTS; i++)
     {
         block[i] = (buffer[4*i+3] & 0xff)
@@ -195,20 +203,558 @@ void buffer_to_block(const std::string &buffer, uint32_t block[BLOCK_INTS])
     }
 }
 
+
+void transform_blocks_scalar(uint32_t digest[], const char *data, std::size_t blocks)
+{
+    for (; blocks != 0; --blocks, data += BLOCK_BYTES)
+    {
+        uint32_t block[BLOCK_INTS];
+        buffer_to_block(data, block);
+        transform(digest, block);
+    }
+}
+
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/*
+ * Same transform with the x86 SHA extensions, four rounds per instruction
+ */
+
+__attribute__((target("sha,sse4.1")))
+void transform_blocks_sha_ni(uint32_t digest[], const char *data, std::size_t blocks)
+{
+    const __m128i MASK = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+
+    __m128i ABCD = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(digest)), 0x1B);
+    __m128i E0 = _mm_set_epi32(static_cast<int>(digest[4]), 0, 0, 0);
+    __m128i E1, MSG0, MSG1, MSG2, MSG3;
+
+    for (; blocks != 0; --blocks, data += BLOCK_BYTES)
+    {
+        const __m128i ABCD_SAVE = ABCD;
+        const __m128i E0_SAVE = E0;
+
+        /* Rounds 0-3 */
+        MSG0 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0)), MASK);
+        E0 = _mm_add_epi32(E0, MSG0);
+        E1 = ABCD;
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 0);
+
+        /* Rounds 4-7 */
+        MSG1 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16)), MASK);
+        E1 = _mm_sha1nexte_epu32(E1, MSG1);
+        E0 = ABCD;
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 0);
+        MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+
+        /* Rounds 8-11 */
+        MSG2 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 32)), MASK);
+        E0 = _mm_sha1nexte_epu32(E0, MSG2);
+        E1 = ABCD;
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 0);
+        MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+        MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+        /* Rounds 12-15 */
+        MSG3 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 48)), MASK);
+        E1 = _mm_sha1nexte_epu32(E1, MSG3);
+        E0 = ABCD;
+        MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 0);
+        MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+        MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+        /* Rounds 16-19 */
+        E0 = _mm_sha1nexte_epu32(E0, MSG0);
+        E1 = ABCD;
+        MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 0);
+        MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+        MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+        /* Rounds 20-23 */
+        E1 = _mm_sha1nexte_epu32(E1, MSG1);
+        E0 = ABCD;
+        MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 1);
+        MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+        MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+        /* Rounds 24-27 */
+        E0 = _mm_sha1nexte_epu32(E0, MSG2);
+        E1 = ABCD;
+        MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 1);
+        MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+        MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+        /* Rounds 28-31 */
+        E1 = _mm_sha1nexte_epu32(E1, MSG3);
+        E0 = ABCD;
+        MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 1);
+        MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+        MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+        /* Rounds 32-35 */
+        E0 = _mm_sha1nexte_epu32(E0, MSG0);
+        E1 = ABCD;
+        MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 1);
+        MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+        MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+        /* Rounds 36-39 */
+        E1 = _mm_sha1nexte_epu32(E1, MSG1);
+        E0 = ABCD;
+        MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 1);
+        MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+        MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+        /* Rounds 40-43 */
+        E0 = _mm_sha1nexte_epu32(E0, MSG2);
+        E1 = ABCD;
+        MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 2);
+        MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+        MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+        /* Rounds 44-47 */
+        E1 = _mm_sha1nexte_epu32(E1, MSG3);
+        E0 = ABCD;
+        MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 2);
+        MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+        MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+        /* Rounds 48-51 */
+        E0 = _mm_sha1nexte_epu32(E0, MSG0);
+        E1 = ABCD;
+        MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 2);
+        MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+        MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+        /* Rounds 52-55 */
+        E1 = _mm_sha1nexte_epu32(E1, MSG1);
+        E0 = ABCD;
+        MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 2);
+        MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+        MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+        /* Rounds 56-59 */
+        E0 = _mm_sha1nexte_epu32(E0, MSG2);
+        E1 = ABCD;
+        MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 2);
+        MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+        MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+        /* Rounds 60-63 */
+        E1 = _mm_sha1nexte_epu32(E1, MSG3);
+        E0 = ABCD;
+        MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 3);
+        MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+        MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+        /* Rounds 64-67 */
+        E0 = _mm_sha1nexte_epu32(E0, MSG0);
+        E1 = ABCD;
+        MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 3);
+        MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+        MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+        /* Rounds 68-71 */
+        E1 = _mm_sha1nexte_epu32(E1, MSG1);
+        E0 = ABCD;
+        MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 3);
+        MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+        /* Rounds 72-75 */
+        E0 = _mm_sha1nexte_epu32(E0, MSG2);
+        E1 = ABCD;
+        MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 3);
+
+        /* Rounds 76-79 */
+        E1 = _mm_sha1nexte_epu32(E1, MSG3);
+        E0 = ABCD;
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 3);
+
+        E0 = _mm_sha1nexte_epu32(E0, E0_SAVE);
+        ABCD = _mm_add_epi32(ABCD, ABCD_SAVE);
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(digest), _mm_shuffle_epi32(ABCD, 0x1B));
+    digest[4] = static_cast<uint32_t>(_mm_extract_epi32(E0, 3));
+}
+
+
+bool cpu_has_sha_ni()
+{
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_SSE4_1) || !(ecx & bit_SSSE3))
+    {
+        return false;
+    }
+    return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & bit_SHA);
+}
+
+#endif
+
+
+using transform_function = void (*)(uint32_t digest[], const char *data, std::size_t blocks);
+
+
+struct transform_backend
+{
+    transform_function function;
+    const char *name;
+};
+
+
+/*
+ * Picked once by CPUID, every SHA1 object shares the choice
+ */
+
+const transform_backend &backend()
+{
+    static const transform_backend selected = []() -> transform_backend
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        if (cpu_has_sha_ni())
+        {
+            return {transform_blocks_sha_ni, "sha-ni"};
+        }
+#endif
+        return {transform_blocks_scalar, "scalar"};
+    }();
+    return selected;
+}
+
+
+void transform_blocks(uint32_t digest[], const char *data, std::size_t blocks, uint64_t &transforms)
+{
+    backend().function(digest, data, blocks);
+    transforms += blocks;
+}
+
+
+/*
+ * Multi-buffer SHA1: every SIMD lane runs the scalar rounds for a different
+ * message, so 8 (AVX2) or 16 (AVX-512) independent blocks are hashed at once.
+ * Used by SHA1::hash_many for whole groups of messages.
+ */
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/*
+ * The rounds are written with GCC vector extensions and inlined into functions
+ * compiled for the instruction set, so the same code becomes AVX2 or AVX-512
+ */
+
+template <std::size_t LANES>
+struct lane_vector
+{
+    typedef uint32_t type __attribute__((vector_size(LANES * 4)));
+};
+
+
+template <int BITS, typename VectorT>
+__attribute__((always_inline)) inline void rol_lanes(VectorT &value)
+{
+    value = (value << BITS) | (value >> (32 - BITS));
+}
+
+
+/*
+ * Hashes blocks whole blocks of every lane, state is [word][lane]
+ */
+
+template <std::size_t LANES>
+__attribute__((always_inline)) inline void transform_lanes(uint32_t state[5][LANES], 
+    const char *const data[], std::size_t blocks)
+{
+    using vector = typename lane_vector<LANES>::type;
+
+    vector a, b, c, d, e;
+    std::memcpy(&a, state[0], sizeof(vector));
+    std::memcpy(&b, state[1], sizeof(vector));
+    std::memcpy(&c, state[2], sizeof(vector));
+    std::memcpy(&d, state[3], sizeof(vector));
+    std::memcpy(&e, state[4], sizeof(vector));
+
+    for (std::size_t offset = 0; offset != blocks * BLOCK_BYTES; offset += BLOCK_BYTES)
+    {
+        /* Transpose the block words so each vector holds one word of every lane */
+        vector w[BLOCK_INTS];
+        for (std::size_t i = 0; i < BLOCK_INTS; i++)
+        {
+            for (std::size_t lane = 0; lane < LANES; lane++)
+            {
+                uint32_t word;
+                std::memcpy(&word, data[lane] + offset + 4*i, sizeof(word));
+                w[i][lane] = __builtin_bswap32(word);
+            }
+        }
+
+        const vector a_save = a, b_save = b, c_save = c, d_save = d, e_save = e;
+        for (std::size_t i = 0; i < 80; i++)
+        {
+            if (i >= BLOCK_INTS)
+            {
+                w[i&15] = w[(i+13)&15] ^ w[(i+8)&15] ^ w[(i+2)&15] ^ w[i&15];
+                rol_lanes<1>(w[i&15]);
+            }
+
+            vector f;
+            uint32_t k;
+            if (i < 20)
+            {
+                f = d ^ (b & (c ^ d));
+                k = 0x5a827999;
+            }
+            else if (i < 40)
+            {
+                f = b ^ c ^ d;
+                k = 0x6ed9eba1;
+            }
+            else if (i < 60)
+            {
+                f = (b & c) | (d & (b | c));
+                k = 0x8f1bbcdc;
+            }
+            else
+            {
+                f = b ^ c ^ d;
+                k = 0xca62c1d6;
+            }
+
+            vector temp = a;
+            rol_lanes<5>(temp);
+            temp += f + e + k + w[i&15];
+            e = d;
+            d = c;
+            c = b;
+            rol_lanes<30>(c);
+            b = a;
+            a = temp;
+        }
+
+        a += a_save;
+        b += b_save;
+        c += c_save;
+        d += d_save;
+        e += e_save;
+    }
+
+    std::memcpy(state[0], &a, sizeof(vector));
+    std::memcpy(state[1], &b, sizeof(vector));
+    std::memcpy(state[2], &c, sizeof(vector));
+    std::memcpy(state[3], &d, sizeof(vector));
+    std::memcpy(state[4], &e, sizeof(vector));
+}
+
+
+const std::size_t AVX2_LANES = 8;
+const std::size_t AVX512_LANES = 16;
+
+
+__attribute__((target("avx2")))
+void transform_lanes_avx2(uint32_t state[5][AVX2_LANES], const char *const data[], std::size_t blocks)
+{
+    transform_lanes<AVX2_LANES>(state, data, blocks);
+}
+
+
+__attribute__((target("avx512f")))
+void transform_lanes_avx512(uint32_t state[5][AVX512_LANES], const char *const data[], std::size_t blocks)
+{
+    transform_lanes<AVX512_LANES>(state, data, blocks);
+}
+
+
+/*
+ * AVX state must also be enabled by the OS, not only reported by CPUID
+ */
+
+bool os_saves_state(uint64_t mask)
+{
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_OSXSAVE))
+    {
+        return false;
+    }
+    uint32_t low, high;
+    __asm__("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+    return ((static_cast<uint64_t>(high) << 32 | low) & mask) == mask;
+}
+
+
+std::size_t cpu_multi_buffer_lanes()
+{
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+    {
+        return 1;
+    }
+    if ((ebx & bit_AVX512F) && os_saves_state(0xE6))
+    {
+        return AVX512_LANES;
+    }
+    if ((ebx & bit_AVX2) && os_saves_state(0x06))
+    {
+        return AVX2_LANES;
+    }
+    return 1;
+}
+
+#endif
+
+
+/*
+ * Lanes hashed together by hash_many, 1 when every message is hashed on its
+ * own. 16 full AVX-512 lanes outrun one SHA-NI stream, 8 AVX2 lanes don't.
+ */
+
+std::size_t selected_lanes()
+{
+    static const std::size_t lanes = []() -> std::size_t
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        std::size_t simd_lanes = cpu_multi_buffer_lanes();
+        if (simd_lanes == AVX512_LANES || !cpu_has_sha_ni())
+        {
+            return simd_lanes;
+        }
+#endif
+        return 1;
+    }();
+    return lanes;
 }
 
-const std::size_t SHA1::DIGEST_SIZE = 20;
+
+/*
+ * Hashes the bytes after the common blocks and the padding, continuing from digest
+ */
+
+void finish_digest(uint32_t digest[], const char *data, std::size_t size, uint64_t total_size, SHA1::digest_type &out)
+{
+    std::size_t blocks = size / BLOCK_BYTES;
+    backend().function(digest, data, blocks);
+
+    char tail[BLOCK_BYTES * 2] = {};
+    std::size_t tail_size = size - blocks * BLOCK_BYTES;
+    std::memcpy(tail, data + blocks * BLOCK_BYTES, tail_size);
+    tail[tail_size] = (char)0x80;
+    std::size_t padded = tail_size + 1 + 8 <= BLOCK_BYTES ? BLOCK_BYTES : BLOCK_BYTES * 2;
+    uint64_t total_bits = total_size * 8;
+    for (std::size_t i = 0; i < 8; i++)
+    {
+        tail[padded - 1 - i] = (char)(total_bits >> (8*i));
+    }
+    backend().function(digest, tail, padded / BLOCK_BYTES);
+
+    for (std::size_t i = 0; i < 5; i++)
+    {
+        for (std::size_t byte = 0; byte < 4; byte++)
+        {
+            out[4*i + byte] = static_cast<uint8_t>(digest[i] >> (24 - 8*byte));
+        }
+    }
+}
+
+
+const uint32_t INITIAL_DIGEST[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+
+
+/*
+ * Hashes the leading inputs that fill whole groups of LANES messages, and
+ * returns how many were hashed. A partly filled group would cost as much as a
+ * full one, so the rest are left to the single stream transform.
+ */
+
+template <std::size_t LANES, typename KernelT>
+std::size_t hash_lanes(std::span<const std::span<const std::byte>> inputs, std::span<SHA1::digest_type> outputs, KernelT kernel)
+{
+    std::size_t full = inputs.size() / LANES * LANES;
+    for (std::size_t first = 0; first < full; first += LANES)
+    {
+        const char *data[LANES];
+        std::size_t common_blocks = SIZE_MAX;
+        for (std::size_t lane = 0; lane < LANES; lane++)
+        {
+            std::span<const std::byte> input = inputs[first + lane];
+            data[lane] = reinterpret_cast<const char*>(input.data());
+            common_blocks = std::min(common_blocks, input.size() / BLOCK_BYTES);
+        }
+
+        uint32_t state[5][LANES];
+        for (std::size_t i = 0; i < 5; i++)
+        {
+            std::fill_n(state[i], LANES, INITIAL_DIGEST[i]);
+        }
+        kernel(state, data, common_blocks);
+
+        for (std::size_t lane = 0; lane < LANES; lane++)
+        {
+            std::span<const std::byte> input = inputs[first + lane];
+            uint32_t digest[5] = {state[0][lane], state[1][lane], state[2][lane], state[3][lane], state[4][lane]};
+            std::size_t done = common_blocks * BLOCK_BYTES;
+            finish_digest(digest, data[lane] + done, input.size() - done, input.size(), outputs[first + lane]);
+        }
+    }
+    return full;
+}
+
+}
 
 SHA1::SHA1()
 {
-    reset(digest, buffer, transforms);
+    reset(digest, buffer_size, transforms);
 }
 
 
 void SHA1::update(const std::string &s)
 {
-    std::istringstream is(s);
-    update(is);
+    update(s.data(), s.size());
+}
+
+
+void SHA1::update(const void *input, std::size_t size)
+{
+    const char *data = static_cast<const char*>(input);
+
+    /* Complete a partially filled block first */
+    if (buffer_size != 0)
+    {
+        std::size_t taken = std::min(size, BLOCK_BYTES - buffer_size);
+        std::memcpy(buffer + buffer_size, data, taken);
+        buffer_size += taken;
+        data += taken;
+        size -= taken;
+        if (buffer_size != BLOCK_BYTES)
+        {
+            return;
+        }
+        transform_blocks(digest, buffer, 1, transforms);
+        buffer_size = 0;
+    }
+
+    /* Whole blocks are hashed in place */
+    std::size_t blocks = size / BLOCK_BYTES;
+    transform_blocks(digest, data, blocks, transforms);
+    data += blocks * BLOCK_BYTES;
+    size -= blocks * BLOCK_BYTES;
+
+    std::memcpy(buffer, data, size);
+    buffer_size = size;
 }
 
 
@@ -216,17 +762,14 @@ void SHA1::update(std::istream &is)
 {
     while (true)
     {
-        char sbuf[BLOCK_BYTES];
-        is.read(sbuf, BLOCK_BYTES - buffer.size());
-        buffer.append(sbuf, (std::size_t)is.gcount());
-        if (buffer.size() != BLOCK_BYTES)
+        is.read(buffer + buffer_size, BLOCK_BYTES - buffer_size);
+        buffer_size += (std::size_t)is.gcount();
+        if (buffer_size != BLOCK_BYTES)
         {
             return;
         }
-        uint32_t block[BLOCK_INTS];
-        buffer_to_block(buffer, block);
-        transform(digest, block, transforms);
-        buffer.clear();
+        transform_blocks(digest, buffer, 1, transforms);
+        buffer_size = 0;
     }
 }
 
@@ -235,48 +778,109 @@ void SHA1::update(std::istream &is)
  * Add padding and return the message digest.
  */
 
+SHA1::digest_type SHA1::final_raw()
+{
+    digest_type result;
+    finish_digest(digest, buffer, buffer_size, transforms*BLOCK_BYTES + buffer_size, result);
+
+    /* Reset for next run */
+    reset(digest, buffer_size, transforms);
+
+    return result;
+}
+
+
 std::string SHA1::final()
 {
-    /* Total number of hashed bits */
-    uint64_t total_bits = (transforms*BLOCK_BYTES + buffer.size()) * 8;
+    static const char HEX_DIGITS[] = "0123456789abcdef";
 
-    /* Padding */
-    buffer += (char)0x80;
-    std::size_t orig_size = buffer.size();
-    while (buffer.size() < BLOCK_BYTES)
+    digest_type raw = final_raw();
+    std::string result(DIGEST_SIZE * 2, '0');
+    for (std::size_t i = 0; i < DIGEST_SIZE; i++)
     {
-        buffer += (char)0x00;
+        result[2*i] = HEX_DIGITS[raw[i] >> 4];
+        result[2*i + 1] = HEX_DIGITS[raw[i] & 0xf];
     }
+    return result;
+}
+
+
+SHA1::midstate SHA1::save_state() const
+{
+    midstate state;
+    std::copy_n(digest, 5, state.digest);
+    state.buffer_size = (uint32_t)buffer_size;
+    state.transforms = transforms;
+    std::memset(state.buffer, 0, sizeof(state.buffer));
+    std::memcpy(state.buffer, buffer, buffer_size);
+    return state;
+}
 
-    uint32_t block[BLOCK_INTS];
-    buffer_to_block(buffer, block);
 
-    if (orig_size > BLOCK_BYTES - 8)
+void SHA1::restore_state(const midstate &state)
+{
+    if (state.buffer_size >= BLOCK_BYTES)
     {
-        transform(digest, block, transforms);
-        for (std::size_t i = 0; i < BLOCK_INTS - 2; i++)
-        {
-            block[i] = 0;
-        }
+        throw std::runtime_error("SHA1: invalid midstate: partial block of " + std::to_string(state.buffer_size) + " bytes");
     }
 
-    /* Append total_bits, split this uint64_t into two uint32_t */
-    block[BLOCK_INTS - 1] = (uint32_t)total_bits;
-    block[BLOCK_INTS - 2] = (uint32_t)(total_bits >> 32);
-    transform(digest, block, transforms);
+    std::copy_n(state.digest, 5, digest);
+    buffer_size = state.buffer_size;
+    transforms = state.transforms;
+    std::memcpy(buffer, state.buffer, buffer_size);
+}
+
 
-    /* Hex std::string */
-    std::ostringstream result;
-    for (std::size_t i = 0; i < sizeof(digest) / sizeof(digest[0]); i++)
+std::vector<SHA1::digest_type> SHA1::hash_many(std::span<const std::span<const std::byte>> inputs)
+{
+    std::vector<digest_type> result(inputs.size());
+    std::size_t hashed = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    if (selected_lanes() == AVX512_LANES)
+    {
+        hashed = hash_lanes<AVX512_LANES>(inputs, result, transform_lanes_avx512);
+    }
+    else if (selected_lanes() == AVX2_LANES)
     {
-        result << std::hex << std::setfill('0') << std::setw(8);
-        result << digest[i];
+        hashed = hash_lanes<AVX2_LANES>(inputs, result, transform_lanes_avx2);
     }
+#endif
+
+    for (std::size_t i = hashed; i < inputs.size(); i++)
+    {
+        uint32_t digest[5];
+        std::copy_n(INITIAL_DIGEST, 5, digest);
+        finish_digest(digest, reinterpret_cast<const char*>(inputs[i].data()), inputs[i].size(), inputs[i].size(), result[i]);
+    }
+    return result;
+}
 
-    /* Reset for next run */
-    reset(digest, buffer, transforms);
 
-    return result.str();
+std::size_t SHA1::multi_buffer_lanes()
+{
+    return selected_lanes();
+}
+
+
+const char *SHA1::implementation()
+{
+    return backend().name;
+}
+
+
+const char *SHA1::multi_buffer_implementation()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (selected_lanes() == AVX512_LANES)
+    {
+        return "avx512";
+    }
+    if (selected_lanes() == AVX2_LANES)
+    {
+        return "avx2";
+    }
+#endif
+    return implementation();
 }
 
 
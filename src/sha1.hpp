@@ -23,31 +23,75 @@
 #define SHA1_HPP
 
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
 #include <fstream>
-#include <iomanip>
 #include <iostream>
-#include <sstream>
+#include <span>
 #include <string>
+#include <type_traits>
+#include <vector>
 
 
 class SHA1
 {
 public:
-    static const std::size_t DIGEST_SIZE;
+    static constexpr std::size_t DIGEST_SIZE = 20;
+    using digest_type = std::array<uint8_t, DIGEST_SIZE>;
+
+    /* Hashing progress of an unfinished message, trivially copyable and free of
+       padding so it can be stored as is and resumed later on the same machine */
+    struct midstate
+    {
+        uint32_t digest[5];
+        uint32_t buffer_size;
+        uint64_t transforms;
+        uint8_t buffer[64];
+
+        // bytes hashed so far
+        uint64_t length() const { return transforms * sizeof(buffer) + buffer_size; }
+    };
 
     SHA1();
     void update(const std::string &s);
+    // whole 64-byte blocks are hashed straight from data, only a partial tail is copied
+    void update(const void *data, std::size_t size);
+    void update(std::span<const std::byte> data) { update(data.data(), data.size()); }
     void update(std::istream &is);
+    // hex digest
     std::string final();
+    // binary digest, both reset the hasher for the next message
+    digest_type final_raw();
+
+    midstate save_state() const;
+    // continues the message the state was saved from, throws on a malformed state
+    void restore_state(const midstate &state);
     static std::string from_file(const std::string &filename);
+    // transform selected for this CPU, "sha-ni" or "scalar"
+    static const char *implementation();
+
+    // digests of many independent messages, every whole group of multi_buffer_lanes() is hashed
+    // side by side in AVX2/AVX-512 lanes, the rest one at a time like SHA1 objects do
+    static std::vector<digest_type> hash_many(std::span<const std::span<const std::byte>> inputs);
+    // messages hash_many hashes together, 1 when it hashes one at a time
+    static std::size_t multi_buffer_lanes();
+    // engine hash_many uses, "avx512", "avx2" or the same as implementation()
+    static const char *multi_buffer_implementation();
 
 private:
+    static constexpr std::size_t BLOCK_SIZE = 64;
+
     uint32_t digest[5];
-    std::string buffer;
+    char buffer[BLOCK_SIZE];
+    std::size_t buffer_size;
     uint64_t transforms;
 };
 
 
 
+static_assert(std::is_trivially_copyable_v<SHA1::midstate>);
+static_assert(sizeof(SHA1::midstate) == 96, "SHA1::midstate must not contain padding");
+
+
 #endif /* SHA1_HPP */
\ No newline at end of file
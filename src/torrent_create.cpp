@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <ctime>
+#include <filesystem>
+#include <stdexcept>
+#include <vector>
+
+#include "lib/nlohmann/json.hpp"
+#include "bencoder.hpp"
+#include "piece_hasher.hpp"
+#include "sha1.hpp"
+#include "torrent_create.hpp"
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+namespace {
+
+const std::int64_t MIN_PIECE_LENGTH = 1 << 18;
+const std::int64_t MAX_PIECE_LENGTH = 1 << 24;
+// pieces in a torrent before the automatic piece length is doubled
+const std::int64_t TARGET_PIECE_COUNT = 2048;
+
+
+struct input_file {
+    fs::path path;
+    std::vector<std::string> components; // relative to the torrent root
+    std::int64_t length;
+};
+
+
+std::vector<input_file> collect_files(const fs::path &root) {
+    std::vector<input_file> result;
+    if (fs::is_regular_file(root)) {
+        result.push_back({root, {}, static_cast<std::int64_t>(fs::file_size(root))});
+        return result;
+    }
+
+    if (!fs::is_directory(root))
+        throw std::runtime_error("create_torrent: not a file or directory: " + root.string());
+
+    for (const fs::directory_entry &entry : fs::recursive_directory_iterator {root}) {
+        if (!entry.is_regular_file())
+            continue;
+
+        input_file file {entry.path(), {}, static_cast<std::int64_t>(entry.file_size())};
+        for (const fs::path &component : fs::relative(entry.path(), root))
+            file.components.push_back(component.string());
+        result.push_back(std::move(file));
+    }
+
+    if (result.empty())
+        throw std::runtime_error("create_torrent: directory has no files: " + root.string());
+
+    std::sort(result.begin(), result.end(), [](const input_file &a, const input_file &b) { 
+        return a.components < b.components; 
+    });
+    return result;
+}
+
+
+std::int64_t choose_piece_length(std::int64_t total_length) {
+    std::int64_t result = MIN_PIECE_LENGTH;
+    while (result < MAX_PIECE_LENGTH && total_length / result > TARGET_PIECE_COUNT)
+        result *= 2;
+    return result;
+}
+
+
+bit_torrent::piece_hashes hash_files(const std::vector<input_file> &files, std::int64_t piece_length, unsigned threads) {
+    std::vector<bit_torrent::piece_file> piece_files;
+    piece_files.reserve(files.size());
+    for (const input_file &file : files)
+        piece_files.push_back({file.path, file.length});
+
+    bit_torrent::piece_hashes hashes = bit_torrent::hash_pieces(piece_files, piece_length, threads);
+    if (std::find(hashes.readable.begin(), hashes.readable.end(), false) != hashes.readable.end())
+        throw std::runtime_error("create_torrent: files changed while reading");
+    return hashes;
+}
+
+
+// concatenated digests of all pieces, in the container json binary values own
+json::binary_t::container_type piece_digests(const bit_torrent::piece_hashes &hashes) {
+    json::binary_t::container_type result;
+    result.reserve(hashes.digests.size() * SHA1::DIGEST_SIZE);
+    for (const SHA1::digest_type &digest : hashes.digests)
+        result.insert(result.end(), digest.begin(), digest.end());
+    return result;
+}
+
+}
+
+
+bit_torrent::torrent_create_result bit_torrent::create_torrent(const std::string &path, const torrent_create_options &options, bencode_sink &output) {
+    fs::path root = fs::path {path}.lexically_normal();
+    if (!root.has_filename())
+        root = root.parent_path();
+
+    std::vector<input_file> files = collect_files(root);
+    std::int64_t total_length = 0;
+    for (const input_file &file : files)
+        total_length += file.length;
+
+    torrent_create_result result {};
+    result.piece_length = options.piece_length != 0 ? options.piece_length : choose_piece_length(total_length);
+    if (result.piece_length <= 0)
+        throw std::runtime_error("create_torrent: piece length must be positive");
+
+    piece_hashes hashes = hash_files(files, result.piece_length, options.threads);
+    result.hash_workers = hashes.workers;
+
+    json info = {
+        {"name", root.filename().string()},
+        {"piece length", result.piece_length},
+        {"pieces", json::binary(piece_digests(hashes))}
+    };
+    if (files.front().components.empty()) {
+        info["length"] = total_length;
+    } else {
+        json file_list = json::array();
+        for (const input_file &file : files)
+            file_list.push_back({{"length", file.length}, {"path", file.components}});
+        info["files"] = std::move(file_list);
+    }
+
+    // the info hash is computed over the same encoding that is written below
+    SHA1 hasher {};
+    sha1_sink info_sink {hasher};
+    bencode_json(info, info_sink);
+
+    json torrent = {{"creation date", static_cast<std::int64_t>(std::time(nullptr))}};
+    torrent["info"] = std::move(info); // pieces are large, don't copy them
+    if (!options.announce.empty())
+        torrent["announce"] = options.announce;
+
+    bencode_json(torrent, output);
+    result.info_hash = hasher.final();
+    return result;
+}
@@ -0,0 +1,33 @@
+#ifndef TORRENT_CREATE_HPP
+#define TORRENT_CREATE_HPP
+
+#include <cstdint>
+#include <string>
+
+#include "bencode_sink.hpp"
+
+namespace bit_torrent {
+
+struct torrent_create_options {
+    std::string announce;
+    std::int64_t piece_length = 0; // chosen from the total size when 0
+    unsigned threads = 0;
+};
+
+
+struct torrent_create_result {
+    std::string info_hash; // hex
+    std::int64_t piece_length = 0;
+    std::size_t hash_workers = 0; // most threads one batch of pieces was hashed on
+};
+
+
+/*
+    Writes a .torrent describing a file or a directory tree into output.
+    Pieces are hashed with hash_pieces, so reading and hashing overlap.
+*/
+torrent_create_result create_torrent(const std::string &path, const torrent_create_options &options, bencode_sink &output);
+
+}
+
+#endif
@@ -0,0 +1,73 @@
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+
+#include "mapped_file.hpp"
+#include "parallel.hpp"
+#include "sha1.hpp"
+#include "torrent_index.hpp"
+#include "torrent_schema.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// torrents indexed in parallel before their entries are passed on
+const std::size_t INDEX_CHUNK = 256;
+
+}
+
+
+bit_torrent::torrent_index_entry bit_torrent::index_torrent(const std::string &path) {
+    torrent_index_entry result {};
+    result.path = path;
+
+    try {
+        mapped_file file {path};
+        torrent_metainfo torrent = bencode_decode<torrent_metainfo>(file.view());
+        const torrent_info &info = torrent.info.value;
+
+        SHA1 hasher {};
+        hasher.update(torrent.info.encoded.data(), torrent.info.encoded.size());
+        result.info_hash = hasher.final();
+        result.total_length = total_length(info);
+        result.piece_count = info.pieces.chunk_count(SHA1::DIGEST_SIZE);
+
+        if (!info.files) {
+            result.files.emplace_back(info.name);
+            return result;
+        }
+
+        result.files.reserve(info.files->size());
+        for (const torrent_file &file_info : *info.files) {
+            std::string file_path {info.name};
+            for (std::string_view component : file_info.path)
+                file_path.append("/").append(component);
+            result.files.push_back(std::move(file_path));
+        }
+    } catch (const std::exception &e) {
+        result.error = e.what();
+    }
+
+    return result;
+}
+
+
+void bit_torrent::index_directory(const std::string &directory, 
+        const std::function<void(const torrent_index_entry &)> &consume, unsigned threads) {
+    std::vector<std::string> paths;
+    for (const fs::directory_entry &entry : fs::recursive_directory_iterator {directory, fs::directory_options::skip_permission_denied}) {
+        if (entry.is_regular_file() && entry.path().extension() == ".torrent")
+            paths.push_back(entry.path().string());
+    }
+    std::sort(paths.begin(), paths.end());
+
+    thread_pool indexers {threads};
+    std::vector<torrent_index_entry> chunk;
+    for (std::size_t first = 0; first < paths.size(); first += INDEX_CHUNK) {
+        chunk.assign(std::min(INDEX_CHUNK, paths.size() - first), {});
+        indexers.parallel_for(chunk.size(), [&](std::size_t i) { chunk[i] = index_torrent(paths[first + i]); });
+        for (const torrent_index_entry &entry : chunk)
+            consume(entry);
+    }
+}
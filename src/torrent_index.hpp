@@ -0,0 +1,30 @@
+#ifndef TORRENT_INDEX_HPP
+#define TORRENT_INDEX_HPP
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace bit_torrent {
+
+struct torrent_index_entry {
+    std::string path;
+    std::string info_hash; // hex
+    std::int64_t total_length = 0;
+    std::size_t piece_count = 0;
+    std::vector<std::string> files; // path components joined with '/'
+    std::string error; // set instead of the fields above if the torrent couldn't be indexed
+};
+
+
+torrent_index_entry index_torrent(const std::string &path);
+
+// indexes every *.torrent file under directory in parallel and passes the entries to consume
+// sorted by path, a chunk at a time, so only one chunk of entries is held in memory
+void index_directory(const std::string &directory, const std::function<void(const torrent_index_entry &)> &consume,
+    unsigned threads = 0);
+
+}
+
+#endif
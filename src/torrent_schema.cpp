@@ -0,0 +1,27 @@
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#include "torrent_schema.hpp"
+
+
+std::int64_t bit_torrent::total_length(const torrent_info &info) {
+    if (info.length) {
+        if (*info.length < 0)
+            throw std::runtime_error("total_length: negative length: " + std::to_string(*info.length));
+        return *info.length;
+    }
+
+    if (!info.files)
+        throw std::runtime_error("total_length: info has neither length nor files");
+
+    std::int64_t result = 0;
+    for (const torrent_file &file : *info.files) {
+        if (file.length < 0)
+            throw std::runtime_error("total_length: negative file length: " + std::to_string(file.length));
+        if (file.length > std::numeric_limits<std::int64_t>::max() - result)
+            throw std::runtime_error("total_length: sum of file lengths overflows");
+        result += file.length;
+    }
+    return result;
+}
@@ -0,0 +1,68 @@
+#ifndef TORRENT_SCHEMA_HPP
+#define TORRENT_SCHEMA_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "bencode_schema.hpp"
+
+namespace bit_torrent {
+
+struct torrent_file {
+    std::int64_t length;
+    std::vector<std::string_view> path;
+};
+
+
+struct torrent_info {
+    std::optional<std::int64_t> length; // single file mode
+    std::string_view name;
+    std::int64_t piece_length;
+    byte_view pieces; // concatenated SHA1 digests
+    std::optional<std::vector<torrent_file>> files; // multi file mode
+};
+
+
+struct torrent_metainfo {
+    std::optional<std::string_view> announce; // missing in trackerless torrents
+    bencode_with_raw<torrent_info> info; // raw bytes are the info hash input
+};
+
+
+template <>
+struct bencode_schema_of<torrent_file> {
+    using type = bencode_schema<
+        bencode_field<"length", &torrent_file::length>,
+        bencode_field<"path", &torrent_file::path>>;
+};
+
+
+template <>
+struct bencode_schema_of<torrent_info> {
+    using type = bencode_schema<
+        bencode_field<"length", &torrent_info::length>,
+        bencode_field<"name", &torrent_info::name>,
+        bencode_field<"piece length", &torrent_info::piece_length>,
+        bencode_field<"pieces", &torrent_info::pieces>,
+        bencode_field<"files", &torrent_info::files>>;
+};
+
+
+template <>
+struct bencode_schema_of<torrent_metainfo> {
+    using type = bencode_schema<
+        bencode_field<"announce", &torrent_metainfo::announce>,
+        bencode_field<"info", &torrent_metainfo::info>>;
+};
+
+
+
+// length in single file mode, sum of file lengths in multi file mode;
+// throws on negative lengths and on a sum that doesn't fit
+std::int64_t total_length(const torrent_info &info);
+
+}
+
+#endif
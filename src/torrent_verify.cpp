@@ -0,0 +1,70 @@
+#include <filesystem>
+#include <stdexcept>
+
+#include "piece_hash_table.hpp"
+#include "piece_hasher.hpp"
+#include "sha1.hpp"
+#include "torrent_verify.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// keeps files named by the torrent inside the data directory
+fs::path safe_component(std::string_view component) {
+    fs::path result {component};
+    if (component.empty() || component == "." || component == ".." || result.has_root_path() ||
+            result.has_parent_path())
+        throw std::runtime_error("verify_torrent: unsafe path component: " + std::string {component});
+    return result;
+}
+
+
+std::vector<bit_torrent::piece_file> layout_files(const bit_torrent::torrent_info &info, const fs::path &data_path) {
+    std::vector<bit_torrent::piece_file> result;
+    if (!info.files) {
+        fs::path file = fs::is_directory(data_path) ? data_path / safe_component(info.name) : data_path;
+        result.push_back({file, info.length.value_or(0)});
+        return result;
+    }
+
+    result.reserve(info.files->size());
+    for (const bit_torrent::torrent_file &file : *info.files) {
+        fs::path file_path = data_path;
+        for (std::string_view component : file.path)
+            file_path /= safe_component(component);
+        result.push_back({std::move(file_path), file.length});
+    }
+    return result;
+}
+
+}
+
+
+bit_torrent::torrent_verify_result bit_torrent::verify_torrent(const torrent_info &info, const std::string &data_path,
+        unsigned threads) {
+    // also rejects negative file lengths, so layout_files() below gets valid ones
+    std::int64_t total = total_length(info);
+    if (info.piece_length <= 0)
+        throw std::runtime_error("verify_torrent: piece length must be positive");
+
+    torrent_verify_result result {};
+    result.piece_count = static_cast<std::size_t>((total + info.piece_length - 1) / info.piece_length);
+    piece_hash_table expected {info.pieces};
+    if (expected.size() != result.piece_count)
+        throw std::runtime_error("verify_torrent: pieces don't match the total length");
+
+    piece_hashes hashes = hash_pieces(layout_files(info, data_path), info.piece_length, threads);
+    result.bytes_hashed = hashes.bytes_read;
+    result.engine = hashes.engine;
+    result.bitfield.assign((result.piece_count + 7) / 8, 0);
+    for (std::size_t i = 0; i < result.piece_count; ++i) {
+        if (!hashes.readable[i] || !expected.matches(i, hashes.digests[i]))
+            continue;
+
+        result.bitfield[i / 8] |= static_cast<std::uint8_t>(0x80 >> (i % 8));
+        ++result.good_pieces;
+    }
+
+    return result;
+}
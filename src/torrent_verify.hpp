@@ -0,0 +1,31 @@
+#ifndef TORRENT_VERIFY_HPP
+#define TORRENT_VERIFY_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "torrent_schema.hpp"
+
+namespace bit_torrent {
+
+struct torrent_verify_result {
+    std::size_t piece_count = 0;
+    std::size_t good_pieces = 0;
+    std::vector<std::uint8_t> bitfield; // peer wire layout, piece 0 is the high bit of the first byte
+    std::uint64_t bytes_hashed = 0; // read from the data, missing parts not included
+    const char *engine = nullptr;   // SHA1 engine that hashed most pieces
+};
+
+
+/*
+    Checks local data against the piece hashes of a torrent. data_path is
+    the file itself in single file mode (or the directory holding it) and
+    the torrent root directory in multi file mode. Missing and truncated
+    files don't stop the check, the pieces they cover are reported bad.
+*/
+torrent_verify_result verify_torrent(const torrent_info &info, const std::string &data_path, unsigned threads = 0);
+
+}
+
+#endif
@@ -2,12 +2,15 @@
 #include "string.h"
 #include "errno.h"
 #include "netdb.h"
+#include <algorithm>
+#include <iomanip>
 #include <sstream>
 #include <array>
 #include <vector>
 #include <string>
 #include <map>
 
+#include "bencode_push_parser.hpp"
 #include "sha1.hpp"
 #include "tracker_request.hpp"
 #include "sun_iostreambuf.hpp"
@@ -138,12 +141,11 @@ std::pair<std::string, std::string> get_hostport_from_httpurl(const std::string
 }
 
 
-} // anon namespace
-
-
-std::string bit_torrent::tracker_request::request(const std::string &url, 
-        const std::string &info_hash, const std::string &peer_id, std::size_t uploaded, 
-        std::size_t downloaded, std::uint64_t left, bool compact) {
+// sends the announce request and passes the response body to consume_body chunk by chunk
+template <typename ConsumerT>
+void perform_request(const std::string &url, 
+        const SHA1::digest_type &info_hash, const std::string &peer_id, std::size_t uploaded, 
+        std::size_t downloaded, std::uint64_t left, bool compact, ConsumerT &&consume_body) {
         
     addrinfo hints, *addrlist;
 
@@ -181,13 +183,9 @@ std::string bit_torrent::tracker_request::request(const std::string &url,
     if (sock_fd == -1)
         throw std::runtime_error("tracker_request: unable to create active socket");
     
-    std::string raw_digest (SHA1::DIGEST_SIZE, '\0');
-    for (int i = 0; i < SHA1::DIGEST_SIZE; ++i)
-        raw_digest[i] = std::stoi(info_hash.substr(2*i, 2), nullptr, 16);
-    
     std::stringstream url_stream;
     url_stream << url<< '?'
-        << "info_hash=" << url_encode(raw_digest) << '&'
+        << "info_hash=" << url_encode(info_hash) << '&'
         << "peer_id=" <<  peer_id << '&'
         << "port=" << 6881 << '&'
         << "uploaded=" << uploaded << '&'
@@ -216,14 +214,74 @@ std::string bit_torrent::tracker_request::request(const std::string &url,
         throw std::runtime_error("tracker_request: response doesn't have Content-Length header");
     
     std::size_t content_length = std::stoi(resp.headers.at("Content-Length"));
-    std::string bencoded_response (content_length, '&');
-    if (!socket_stream.read(bencoded_response.data(), content_length))
-        throw std::runtime_error("tracker_request: unable to read enough bytes from response");
+    std::size_t bytes_remains = content_length;
+    std::array<char, 1024> chunk;
+    while (bytes_remains != 0) {
+        // take whatever the socket has delivered instead of waiting for the whole body
+        if (socket_buffer.in_avail() <= 0 && 
+            socket_buffer.sgetc() == std::iostream::traits_type::eof())
+            throw std::runtime_error("tracker_request: content_length is " + 
+                std::to_string(content_length) + ", readed " +
+                std::to_string(content_length - bytes_remains));
+
+        std::streamsize chunk_size = std::min<std::streamsize>({
+            socket_buffer.in_avail(), 
+            static_cast<std::streamsize>(chunk.size()), 
+            static_cast<std::streamsize>(bytes_remains)});
+        chunk_size = socket_buffer.sgetn(chunk.data(), chunk_size);
+
+        consume_body(std::string_view {chunk.data(), static_cast<std::size_t>(chunk_size)});
+        bytes_remains -= chunk_size;
+    }
+}   
 
-    if (socket_stream.gcount() != content_length)
-        throw std::runtime_error("tracker_request: content_length is " + 
-            std::to_string(content_length) + ", readed " +
-            std::to_string(socket_stream.gcount()));
+
+} // anon namespace
+
+
+bool bit_torrent::tracker_response_visitor::on_integer(std::int64_t value) {
+    if (depth_ == 1 && key_ == "interval")
+        interval = value;
+    return true;
+}
+
+
+bool bit_torrent::tracker_response_visitor::on_string(std::string_view value) {
+    if (depth_ == 1 && key_ == "failure reason")
+        failure_reason.emplace(value);
+    else if (depth_ == 1 && key_ == "peers")
+        peers.emplace(value);
+    return true;
+}
+
+
+bool bit_torrent::tracker_response_visitor::on_dictionary_key(std::string_view key) {
+    if (depth_ == 1)
+        key_ = key;
+    return true;
+}
+
+
+std::string bit_torrent::tracker_request::request(const std::string &url, 
+        const SHA1::digest_type &info_hash, const std::string &peer_id, std::size_t uploaded, 
+        std::size_t downloaded, std::uint64_t left, bool compact) {
+    std::string bencoded_response;
+    perform_request(url, info_hash, peer_id, uploaded, downloaded, left, compact, 
+        [&bencoded_response](std::string_view chunk) { bencoded_response.append(chunk); });
 
     return bencoded_response;
-}   
\ No newline at end of file
+}
+
+
+void bit_torrent::tracker_request::request(const std::string &url, 
+        const SHA1::digest_type &info_hash, const std::string &peer_id, std::size_t uploaded, 
+        std::size_t downloaded, std::uint64_t left, bool compact, bencode_visitor &visitor) {
+    bencode_push_parser parser {visitor};
+    perform_request(url, info_hash, peer_id, uploaded, downloaded, left, compact, 
+        [&parser](std::string_view chunk) {
+            if (parser.feed(chunk) != chunk.size() && !parser.stopped())
+                throw std::runtime_error("tracker_request: unexpected data after bencoded response");
+        });
+
+    parser.finish();
+}
@@ -1,17 +1,48 @@
 #ifndef TRACKER_REQUEST_H
 #define TRACKER_REQUEST_H
 
+#include <cstdint>
+#include <optional>
 #include <string>
 
+#include "bencode_visitor.hpp"
+#include "sha1.hpp"
+
 
 namespace bit_torrent {
 
+// collects the top-level fields of a tracker response while it is being received,
+// values are copied because the parser's views only live during a handler call
+class tracker_response_visitor final : public bencode_visitor {
+    std::size_t depth_ = 0;
+    std::string key_;
+
+public:
+    std::optional<std::string> failure_reason;
+    std::optional<std::int64_t> interval;
+    std::optional<std::string> peers; // compact format
+
+    bool on_integer(std::int64_t value) override;
+    bool on_string(std::string_view value) override;
+    bool on_list_begin() override { ++depth_; return true; }
+    bool on_list_end() override { --depth_; return true; }
+    bool on_dictionary_begin() override { ++depth_; return true; }
+    bool on_dictionary_key(std::string_view key) override;
+    bool on_dictionary_end() override { --depth_; return true; }
+};
+
+
 class tracker_request {
 public:
     static std::string request(const std::string &url, 
-        const std::string &info_hash, const std::string &peer_id, std::size_t uploaded, 
+        const SHA1::digest_type &info_hash, const std::string &peer_id, std::size_t uploaded, 
         std::size_t downloaded, std::uint64_t left, bool compact);
 
+    // decodes the response body while it is being received
+    static void request(const std::string &url, 
+        const SHA1::digest_type &info_hash, const std::string &peer_id, std::size_t uploaded, 
+        std::size_t downloaded, std::uint64_t left, bool compact, bencode_visitor &visitor);
+
 };
 
 }
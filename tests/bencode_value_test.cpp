@@ -0,0 +1,41 @@
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "bencode_parser.hpp"
+#include "bencode_value.hpp"
+
+namespace {
+
+int failures = 0;
+
+
+void check(bool condition, const std::string &what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << '\n';
+        ++failures;
+    }
+}
+
+
+// a repeated key must resolve to the same value in the native and the json mode
+void test_duplicate_key_keeps_last(std::string_view encoded) {
+    bit_torrent::bencode_parser parser {};
+    bit_torrent::bencode_document document = parser.parse_document(encoded);
+    const bit_torrent::bencode_value &root = document.root();
+    std::string name {encoded};
+
+    check(root.as_dictionary().size() == 2, name + ": one pair per key");
+    check(root.at("a").as_integer() == 3, name + ": the last value of a repeated key is kept");
+    check(root.at("b").as_integer() == 2, name + ": other keys are untouched");
+    check(parser.parse(encoded)["a"] == root.at("a").as_integer(), name + ": json mode agrees");
+}
+
+}
+
+
+int main() {
+    test_duplicate_key_keeps_last("d1:ai1e1:bi2e1:ai3ee"); // unsorted
+    test_duplicate_key_keeps_last("d1:ai1e1:ai3e1:bi2ee"); // sorted, repeated key is adjacent
+    return failures == 0 ? 0 : 1;
+}
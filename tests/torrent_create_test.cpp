@@ -0,0 +1,50 @@
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <unistd.h>
+
+#include "bencode_sink.hpp"
+#include "torrent_create.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+int failures = 0;
+
+
+void check(bool condition, const std::string &what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << '\n';
+        ++failures;
+    }
+}
+
+
+// a multi-GiB input gets large pieces, hashing them must still use every thread it's given
+void test_large_input_uses_several_workers() {
+    fs::path directory = fs::temp_directory_path() / ("torrent_create_test_" + std::to_string(getpid()));
+    fs::create_directories(directory);
+    fs::path data = directory / "large.bin";
+    std::ofstream {data}.close();
+    fs::resize_file(data, std::uintmax_t {3} << 30); // sparse, reads as zeros
+
+    std::string encoded;
+    bit_torrent::string_sink sink {encoded};
+    bit_torrent::torrent_create_result result = bit_torrent::create_torrent(data.string(), {"", 0, 4}, sink);
+    fs::remove_all(directory);
+
+    check(result.piece_length >= (1 << 20), "automatic piece length grows with the input");
+    check(result.hash_workers > 1, "pieces are hashed on more than one worker, got " + std::to_string(result.hash_workers));
+    check(!result.info_hash.empty() && !encoded.empty(), "a torrent is written");
+}
+
+}
+
+
+int main() {
+    test_large_input_uses_several_workers();
+    return failures == 0 ? 0 : 1;
+}